@@ -1,92 +1,4167 @@
+/**
+ *  Binary search tree and alternative engines for the same
+ *  insert/find/inorder operations, selectable from the driver.
+ *
+ *  Compile with: g++ -std=c++20 -O2 -mavx2 -pthread bstree.cpp
+ *  (without -mavx2 the B+-tree falls back to scalar node search).
+ *  The disk-backed B+-tree uses mmap and needs a POSIX system.
+ */
+
 #include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <coroutine>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+#define endl '\n'
 using namespace std;
 
 
+/**
+ *  Coroutine returning the answer of one membership query.
+ *  A lookup written as a coroutine suspends right after it prefetches the
+ *  next node; run_interleaved resumes the other lookups meanwhile, so the
+ *  memory latency of one query is hidden behind the work of the others.
+ */
+class lookup_task {
+public:
+  class promise_type {
+  public:
+    bool result = false;
+
+    lookup_task get_return_object() {
+      return lookup_task(coroutine_handle<promise_type>::from_promise(*this));
+    }
+    suspend_always initial_suspend() noexcept { return {}; }
+    suspend_always final_suspend() noexcept { return {}; }
+    void return_value(bool value) { result = value; }
+    void unhandled_exception() { terminate(); }
+  };
+
+  coroutine_handle<promise_type> handle;
+
+  explicit lookup_task (coroutine_handle<promise_type> handle = nullptr) {
+    this->handle = handle;
+  }
+};
+
+/**
+ *  Runs the lookups make_task(0), ..., make_task(n - 1) keeping up to
+ *  width of them in flight and resuming them round-robin.
+ *  A width below 1 runs them one at a time.
+ *  Writes the result of lookup i to out[i].
+ */
+template <class MakeTask>
+void run_interleaved(size_t n, int width, MakeTask make_task, bool* out) {
+  width = max(width, 1);
+  vector<lookup_task> slots(width);
+  vector<size_t> query(width);
+  size_t next = 0;
+  int in_flight = 0;
+
+  for (int i = 0; i < width and next < n; i++, next++) {
+    slots[i] = make_task(next);
+    query[i] = next;
+    in_flight++;
+  }
+
+  while (in_flight > 0) {
+    for (int i = 0; i < width; i++) {
+      if (!slots[i].handle) {
+        continue;
+      }
+
+      slots[i].handle.resume();
+      if (!slots[i].handle.done()) {
+        continue;
+      }
+
+      // Finished - collect the result and refill the slot
+      out[query[i]] = slots[i].handle.promise().result;
+      slots[i].handle.destroy();
+      slots[i].handle = nullptr;
+      in_flight--;
+
+      if (next < n) {
+        slots[i] = make_task(next);
+        query[i] = next++;
+        in_flight++;
+      }
+    }
+  }
+}
+
+
+/**
+ *  Number of times a divide-and-conquer algorithm may fork to keep the
+ *  given number of threads busy (a few extra levels even out unequal halves).
+ */
+static int fork_depth_for(int threads) {
+  int depth = 0;
+  while ((1 << depth) < threads) {
+    depth++;
+  }
+  return (threads <= 1) ? 0 : depth + 2;
+}
+
+/**
+ *  Runs first() and second(). When fork_depth > 0 and the subproblem has
+ *  at least grain elements, first() runs on a new thread meanwhile.
+ *  Both halves pass fork_depth - 1 on to their own forks.
+ */
+template <class First, class Second>
+void fork_join(int fork_depth, size_t work, size_t grain, First first, Second second) {
+  if (fork_depth <= 0 or work < grain) {
+    first();
+    second();
+    return;
+  }
+
+  thread worker(first);
+  second();
+  worker.join();
+}
+
+/**
+ *  Splits [0, n) into threads contiguous chunks and runs
+ *  body(chunk, begin, end) for each of them on its own thread.
+ */
+template <class Body>
+void parallel_chunks(int threads, size_t n, Body body) {
+  vector<thread> workers;
+  for (int t = 1; t < threads; t++) {
+    workers.push_back(thread(body, t, n * t / threads, n * (t + 1) / threads));
+  }
+
+  body(0, 0, n / threads);
+  for (int t = 0; t < (int)workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+/**
+ *  Sorts the keys with a least-significant-digit radix sort: four stable
+ *  passes over 8-bit digits. Each pass counts the digits of every chunk in
+ *  parallel, computes where each chunk writes each digit, and scatters the
+ *  chunks in parallel. The sign bit is flipped so negative keys sort first.
+ *  Complexity: O(n) work, O(n / threads) time per pass.
+ */
+static void parallel_radix_sort(vector<int>& keys, int threads) {
+  size_t n = keys.size();
+  threads = max(1, min(threads, (int)(n / 65536) + 1)); // Not worth a thread below that
+  vector<int> buffer(n);
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    vector<vector<size_t>> offsets(threads, vector<size_t>(256, 0));
+    auto digit = [shift](int x) { return (((uint32_t)x ^ 0x80000000u) >> shift) & 0xff; };
+
+    parallel_chunks(threads, n, [&](int chunk, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        offsets[chunk][digit(keys[i])]++;
+      }
+    });
+
+    // Digit-major, chunk-minor prefix sums keep the sort stable
+    size_t position = 0;
+    for (int d = 0; d < 256; d++) {
+      for (int chunk = 0; chunk < threads; chunk++) {
+        size_t count = offsets[chunk][d];
+        offsets[chunk][d] = position;
+        position += count;
+      }
+    }
+
+    parallel_chunks(threads, n, [&](int chunk, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        buffer[offsets[chunk][digit(keys[i])]++] = keys[i];
+      }
+    });
+
+    keys.swap(buffer);
+  }
+}
+
+
+/**
+ *  Contiguous storage for tree nodes addressed by 32-bit indices.
+ *  Index 0 is reserved and plays the role of the null pointer, so a
+ *  zero-initialised child field means "no child".
+ *  Single nodes can be released for reuse; all nodes are released at once
+ *  when the pool is cleared or destroyed.
+ */
+template <class T>
+class node_pool {
+private:
+  vector<T> nodes;
+  vector<uint32_t> free_ids; // Released slots, reused by allocate
+
+public:
+  static const uint32_t NIL = 0;
+
+  node_pool () {
+    nodes.resize(1);  // The null slot
+  }
+
+  /**
+   *  Stores a new node in a released slot, or appends it, and returns its index.
+   *  May move the other nodes, so references into the pool must not be
+   *  held across this call (indices stay valid).
+   */
+  uint32_t allocate(const T& x) {
+    if (!free_ids.empty()) {
+      uint32_t id = free_ids.back();
+      free_ids.pop_back();
+      nodes[id] = x;
+      return id;
+    }
+
+    nodes.push_back(x);
+    return nodes.size() - 1;
+  }
+
+  /**
+   *  Appends count default nodes and returns the index of the first one.
+   *  Their indices are consecutive, so they can be filled in independently.
+   */
+  uint32_t allocate_range(size_t count) {
+    size_t first = nodes.size();
+    nodes.resize(first + count);
+    return first;
+  }
+
+  /**
+   *  Marks the slot id as free. The caller must have unlinked it.
+   */
+  void release(uint32_t id) {
+    free_ids.push_back(id);
+  }
+
+  T& operator[](uint32_t id) {
+    return nodes[id];
+  }
+
+  const T& operator[](uint32_t id) const {
+    return nodes[id];
+  }
+
+  /**
+   *  Number of nodes in use (without the null slot and the released ones).
+   */
+  size_t size() const {
+    return nodes.size() - 1 - free_ids.size();
+  }
+
+  /**
+   *  One past the largest index handed out so far.
+   */
+  size_t capacity_ids() const {
+    return nodes.size();
+  }
+
+  void reserve(size_t n) {
+    nodes.reserve(n + 1);
+  }
+
+  /**
+   *  Frees all nodes in O(1) (one deallocation, nodes are trivially destructible).
+   */
+  void clear() {
+    vector<T>().swap(nodes);
+    vector<uint32_t>().swap(free_ids);
+    nodes.resize(1);
+  }
+};
+
+
+/**
+ *  A node of bstree: the key and the pool indices of its children.
+ */
 class node {
 public:
   int value;
-  node* left_child;
-  node* right_child;
+  uint32_t left_child;  // Index in the pool, node_pool::NIL if absent
+  uint32_t right_child;
 
-  node (int value) {
+  node (int value = 0) {
     this->value = value;
-    left_child = NULL;
-    right_child = NULL;
+    left_child = node_pool<node>::NIL;
+    right_child = node_pool<node>::NIL;
   }
+};
 
+static_assert(sizeof(node) == 12, "node should pack into 12 bytes");
 
-  void insert(int x) {
-    if (x <= this->value) {
-      if (this->left_child == NULL) {
-        this->left_child = new node(x);
+
+/**
+ *  Implementation of an (unbalanced) binary search tree.
+ *  All operations work iteratively on an explicit tree handle, so the
+ *  stack usage is constant no matter how skewed the tree becomes.
+ *  Nodes live in a node_pool and link to each other by 32-bit indices,
+ *  which makes a node 12 bytes instead of 24.
+ *
+ *  In multiset mode every distinct key has a single node and the number of
+ *  its occurrences is kept in a separate array indexed like the pool, so
+ *  repeated keys cost neither nodes nor depth, and find never touches the
+ *  counts.
+ *
+ *  Operations:
+ *    - Insert operation complexity: O(depth).
+ *    - Find, count and erase complexity: O(depth).
+ *    - lower_bound, upper_bound, predecessor: O(depth).
+ *    - Range scan of k keys: O(depth + k), explicit stack of O(depth).
+ *    - Inorder traversal: O(n) time, O(1) extra memory (Morris traversal).
+ *    - Freeing the whole tree: O(1).
+ */
+class bstree {
+private:
+  static const uint32_t NIL = node_pool<node>::NIL;
+  static const int BATCH_WIDTH = 16; // Queries in flight in find_batch
+  static const int PARALLEL_GRAIN = 65536; // Smallest subtree built on its own thread
+
+  node_pool<node> pool;
+  uint32_t root;
+  int num_keys;             // Including repeated keys
+
+  bool multiset;
+  vector<uint32_t> counts;  // Multiset mode only - occurrences of the key at each pool index
+
+  /**
+   *  Allocates a node for x with count occurrences.
+   */
+  uint32_t new_node(int x, uint32_t count) {
+    uint32_t id = pool.allocate(node(x));
+    if (multiset) {
+      counts.resize(pool.capacity_ids());
+      counts[id] = count;
+    }
+    return id;
+  }
+
+  /**
+   *  Builds the subtree over keys[from..to] with the middle key as its
+   *  root, stored at index id, and returns id. The nodes are laid out in
+   *  preorder: the left subtree takes the next (mid - from) indices and the
+   *  right subtree the ones after, so every index is known up front and the
+   *  two halves can be built on different threads.
+   *  runs[i] is the number of occurrences of keys[i] (multiset mode).
+   *  Recursion depth is O(log n).
+   */
+  uint32_t build(const int* keys, const uint32_t* runs, int from, int to, uint32_t id, int fork_depth) {
+    if (from > to) {
+      return NIL;
+    }
+
+    int mid = from + (to - from) / 2;
+    uint32_t left_id = id + 1;
+    uint32_t right_id = id + 1 + (mid - from);
+
+    pool[id] = node(keys[mid]);
+    if (multiset) {
+      counts[id] = runs[mid];
+    }
+
+    uint32_t left, right;
+    fork_join(fork_depth, to - from + 1, PARALLEL_GRAIN,
+      [&]() { left = build(keys, runs, from, mid - 1, left_id, fork_depth - 1); },
+      [&]() { right = build(keys, runs, mid + 1, to, right_id, fork_depth - 1); });
+
+    pool[id].left_child = left;
+    pool[id].right_child = right;
+    return id;
+  }
+
+  void build(const int* sorted_keys, int n, int threads) {
+    num_keys = n;
+
+    if (!multiset) {
+      uint32_t first = pool.allocate_range(n);
+      root = build(sorted_keys, NULL, 0, n - 1, first, fork_depth_for(threads));
+      return;
+    }
+
+    // Collapse runs of equal keys into one key with a count
+    vector<int> distinct;
+    vector<uint32_t> runs;
+    for (int i = 0; i < n; i++) {
+      if (i > 0 and sorted_keys[i] == sorted_keys[i - 1]) {
+        runs.back()++;
       } else {
-        this->left_child->insert(x);
+        distinct.push_back(sorted_keys[i]);
+        runs.push_back(1);
       }
+    }
+
+    uint32_t first = pool.allocate_range(distinct.size());
+    counts.resize(pool.capacity_ids());
+    root = build(distinct.data(), runs.data(), 0, (int)distinct.size() - 1, first, fork_depth_for(threads));
+  }
+
+  /**
+   *  Returns the link (the root or a child field) that points to a node
+   *  holding x, or to NIL where x would be. Valid until the next allocation.
+   */
+  uint32_t* find_link(int x) {
+    uint32_t* link = &root;
+
+    while (*link != NIL and pool[*link].value != x) {
+      node& n = pool[*link];
+      link = (x < n.value) ? &n.left_child : &n.right_child;
+    }
+
+    return link;
+  }
+
+  /**
+   *  Removes the node *link points to from the tree and releases its slot.
+   *  A node with two children is replaced by its inorder successor.
+   */
+  void unlink(uint32_t* link) {
+    uint32_t target = *link;
+    node& t = pool[target];
+
+    if (t.left_child == NIL) {
+      *link = t.right_child;
+    } else if (t.right_child == NIL) {
+      *link = t.left_child;
     } else {
-      if (this->right_child == NULL) {
-        this->right_child = new node(x);
-      } else {
-        this->right_child->insert(x);
+      uint32_t* successor_link = &t.right_child;
+      while (pool[*successor_link].left_child != NIL) {
+        successor_link = &pool[*successor_link].left_child;
       }
+
+      uint32_t successor = *successor_link;
+      *successor_link = pool[successor].right_child;  // Detach (may update t.right_child)
+
+      pool[successor].left_child = t.left_child;
+      pool[successor].right_child = t.right_child;
+      *link = successor;
     }
+
+    pool.release(target);
   }
 
+  int multiplicity(uint32_t id) const {
+    return multiset ? counts[id] : 1;
+  }
 
-  bool find(int x) {
-    if (this == NULL) {
+public:
+  /**
+   *  Creates an empty tree. In multiset mode equal keys share one node.
+   */
+  explicit bstree (bool multiset = false) {
+    root = NIL;
+    num_keys = 0;
+    this->multiset = multiset;
+  }
+
+  /**
+   *  Time spent in each phase of a bulk load.
+   */
+  class load_timings {
+  public:
+    double sort_ms;   // Checking the order and sorting if needed
+    double build_ms;  // Building the tree from the sorted keys
+  };
+
+  /**
+   *  Bulk-load constructor. Builds a perfectly balanced tree from n keys
+   *  in O(n) if they are already sorted (checked in one pass),
+   *  otherwise radix-sorts a copy first - also O(n).
+   *  Both the sort and the build run on up to threads threads.
+   *  Equal keys may end up on either side of each other, which does not
+   *  affect find. In multiset mode they are collapsed into one node.
+   *  If timings is given, the time of each phase is stored there.
+   */
+  bstree (const int* keys, int n, bool multiset = false, int threads = 1, load_timings* timings = NULL) {
+    root = NIL;
+    this->multiset = multiset;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<int> sorted_keys;
+    bool sorted = is_sorted(keys, keys + n);
+    if (!sorted) {
+      sorted_keys.assign(keys, keys + n);
+      parallel_radix_sort(sorted_keys, threads);
+    }
+
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+    build(sorted ? keys : sorted_keys.data(), n, threads);
+
+    if (timings != NULL) {
+      timings->sort_ms = chrono::duration<double, milli>(middle - start).count();
+      timings->build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - middle).count();
+    }
+  }
+
+  /**
+   *  Inserts x as a new leaf. Duplicates go to the left subtree,
+   *  or only increase the count of the existing node in multiset mode.
+   *  The node is allocated before the walk, so the reference to the
+   *  child link stays valid while it is filled in.
+   */
+  void insert(int x) {
+    num_keys++;
+
+    if (multiset) {
+      uint32_t* link = find_link(x);
+      if (*link != NIL) {
+        counts[*link]++;
+        return;
+      }
+    }
+
+    uint32_t fresh = new_node(x, 1);
+    if (root == NIL) {
+      root = fresh;
+      return;
+    }
+
+    uint32_t current = root;
+    while (true) {
+      node& parent = pool[current];
+      uint32_t& link = (x <= parent.value) ? parent.left_child : parent.right_child;
+
+      if (link == NIL) {
+        link = fresh;
+        return;
+      }
+      current = link;
+    }
+  }
+
+  /**
+   *  Returns the number of occurrences of x.
+   *  Without multiset mode, equal keys can be in both subtrees of a match
+   *  (after a bulk load), so both are searched with an explicit stack.
+   */
+  int count(int x) const {
+    if (multiset) {
+      uint32_t current = root;
+      while (current != NIL and pool[current].value != x) {
+        const node& n = pool[current];
+        current = (x < n.value) ? n.left_child : n.right_child;
+      }
+      return (current == NIL) ? 0 : counts[current];
+    }
+
+    int result = 0;
+    vector<uint32_t> stack(1, root);
+    while (!stack.empty()) {
+      uint32_t current = stack.back();
+      stack.pop_back();
+      if (current == NIL) {
+        continue;
+      }
+
+      const node& n = pool[current];
+      if (x <= n.value) {
+        stack.push_back(n.left_child);
+      }
+      if (x >= n.value) {
+        stack.push_back(n.right_child);
+      }
+      result += (x == n.value);
+    }
+
+    return result;
+  }
+
+  /**
+   *  Removes one occurrence of x. In multiset mode this decrements the
+   *  count and removes the node only when the count drops to zero.
+   *  Returns false if x is not in the tree.
+   */
+  bool erase(int x) {
+    uint32_t* link = find_link(x);
+    if (*link == NIL) {
       return false;
     }
-    else if (this->value == x) {
+
+    num_keys--;
+    if (multiset and --counts[*link] > 0) {
       return true;
     }
 
-    if (x < this->value) {
-      return this->left_child->find(x);
-    } else {
-      return this->right_child->find(x);
+    unlink(link);
+    return true;
+  }
+
+  bool find(int x) const {
+    uint32_t current = root;
+
+    while (current != NIL and pool[current].value != x) {
+      const node& n = pool[current];
+      current = (x < n.value) ? n.left_child : n.right_child;
     }
+
+    return current != NIL;
   }
 
+  /**
+   *  Finds the smallest key >= x. Returns false if there is none.
+   */
+  bool lower_bound(int x, int& result) const {
+    bool found = false;
+    uint32_t current = root;
 
-  void inorder() {
-    if (this == NULL) {
-      return;
+    while (current != NIL) {
+      const node& n = pool[current];
+      if (n.value >= x) {
+        // Candidate - a better one can only be on the left
+        result = n.value;
+        found = true;
+        current = n.left_child;
+      } else {
+        current = n.right_child;
+      }
     }
 
-    this->left_child->inorder();
-    cout << this->value << endl;
-    this->right_child->inorder();
+    return found;
   }
-};
 
-int main() {
+  /**
+   *  Finds the smallest key > x. Returns false if there is none.
+   */
+  bool upper_bound(int x, int& result) const {
+    bool found = false;
+    uint32_t current = root;
 
-  int n;
-  cin >> n;
+    while (current != NIL) {
+      const node& n = pool[current];
+      if (n.value > x) {
+        result = n.value;
+        found = true;
+        current = n.left_child;
+      } else {
+        current = n.right_child;
+      }
+    }
 
-  int a[n + 1];
-  for (int i = 0; i < n; i++) {
-    cin >> a[i];
+    return found;
   }
 
-  node* root = new node(a[0]);
-  for (int i = 1; i < n; i++) {
-    root->insert(a[i]);
+  /**
+   *  Finds the successor of x (the smallest key > x).
+   */
+  bool successor(int x, int& result) const {
+    return upper_bound(x, result);
   }
 
-  // root->inorder();
+  /**
+   *  Finds the predecessor of x (the largest key < x).
+   *  Returns false if there is none.
+   */
+  bool predecessor(int x, int& result) const {
+    bool found = false;
+    uint32_t current = root;
 
-  int q;
-  int e;
-  cin >> q;
+    while (current != NIL) {
+      const node& n = pool[current];
+      if (n.value < x) {
+        // Candidate - a better one can only be on the right
+        result = n.value;
+        found = true;
+        current = n.right_child;
+      } else {
+        current = n.left_child;
+      }
+    }
 
-  for (int i = 0; i < q; i++) {
-    cin >> e;
-    cout << root->find(e) << endl;
+    return found;
+  }
+
+  /**
+   *  Streams the keys in [lo, hi] in sorted order (repeated keys as
+   *  many times as they occur) without touching the rest of the tree.
+   *  The stack holds the nodes whose key and right subtree are still
+   *  to be visited - at most one per level.
+   *  The tree must not be modified while the iterator is in use.
+   *
+   *  Usage:
+   *    for (bstree::range_iterator it = tree.range(lo, hi); it.valid(); it.next()) {
+   *      ... it.value() ...
+   *    }
+   */
+  class range_iterator {
+  private:
+    const bstree* tree;
+    int hi;
+    vector<uint32_t> stack;
+    int repeats;  // Occurrences of the top key not yet returned
+
+    /**
+     *  Pushes current and its left spine, skipping the nodes below lo.
+     */
+    void descend(uint32_t current, int lo) {
+      while (current != NIL) {
+        const node& n = tree->pool[current];
+        if (n.value >= lo) {
+          stack.push_back(current);
+          current = n.left_child;
+        } else {
+          current = n.right_child;
+        }
+      }
+    }
+
+    /**
+     *  Drops the top of the stack if it is past hi, and loads its count.
+     */
+    void settle() {
+      if (!stack.empty() and tree->pool[stack.back()].value > hi) {
+        stack.clear();  // Everything left is even larger
+      }
+      repeats = stack.empty() ? 0 : tree->multiplicity(stack.back());
+    }
+
+  public:
+    range_iterator (const bstree* tree, int lo, int hi) {
+      this->tree = tree;
+      this->hi = hi;
+      descend(tree->root, lo);
+      settle();
+    }
+
+    bool valid() const {
+      return !stack.empty();
+    }
+
+    int value() const {
+      return tree->pool[stack.back()].value;
+    }
+
+    void next() {
+      if (--repeats > 0) {
+        return;
+      }
+
+      uint32_t current = stack.back();
+      stack.pop_back();
+      descend(tree->pool[current].right_child, INT_MIN);
+      settle();
+    }
+  };
+
+  range_iterator range(int lo, int hi) const {
+    return range_iterator(this, lo, hi);
+  }
+
+  /**
+   *  Answers n membership queries: out[i] = find(keys[i]).
+   *  Queries are processed in groups of BATCH_WIDTH that walk down the
+   *  tree in lockstep. Each step advances every query by one level and
+   *  prefetches its next node, so the cache misses of the whole group
+   *  overlap instead of stalling one after another.
+   */
+  void find_batch(const int* keys, size_t n, bool* out) const {
+    for (size_t base = 0; base < n; base += BATCH_WIDTH) {
+      int width = min((size_t)BATCH_WIDTH, n - base);
+      uint32_t current[BATCH_WIDTH];
+
+      for (int i = 0; i < width; i++) {
+        current[i] = root;
+        out[base + i] = false;
+      }
+
+      bool active = (root != NIL);
+      while (active) {
+        active = false;
+
+        for (int i = 0; i < width; i++) {
+          if (current[i] == NIL) {
+            continue; // This query is already answered
+          }
+
+          const node& n = pool[current[i]];
+          int x = keys[base + i];
+          if (n.value == x) {
+            out[base + i] = true;
+            current[i] = NIL;
+            continue;
+          }
+
+          current[i] = (x < n.value) ? n.left_child : n.right_child;
+          __builtin_prefetch(&pool[current[i]]);
+          active |= (current[i] != NIL);
+        }
+      }
+    }
+  }
+
+  /**
+   *  Coroutine version of find. Suspends after prefetching every node
+   *  on the search path.
+   */
+  lookup_task find_task(int x) const {
+    uint32_t current = root;
+
+    while (current != NIL) {
+      const node& n = pool[current];
+      if (n.value == x) {
+        co_return true;
+      }
+
+      current = (x < n.value) ? n.left_child : n.right_child;
+      __builtin_prefetch(&pool[current]);
+      co_await suspend_always();
+    }
+
+    co_return false;
+  }
+
+  /**
+   *  Answers n membership queries with up to width coroutine
+   *  lookups in flight: out[i] = find(keys[i]).
+   */
+  void find_interleaved(const int* keys, size_t n, bool* out, int width) const {
+    run_interleaved(n, width, [this, keys](size_t i) { return find_task(keys[i]); }, out);
+  }
+
+  /**
+   *  Calls visit(value) for every key (repeated keys as many times as they
+   *  occur) in sorted order using Morris traversal:
+   *  the rightmost node of each left subtree temporarily points back to
+   *  its inorder successor, and the link is removed on the second visit.
+   *  The tree is unchanged once the traversal finishes.
+   */
+  template <class Visit>
+  void for_each_inorder(Visit visit) {
+    uint32_t current = root;
+
+    while (current != NIL) {
+      if (pool[current].left_child == NIL) {
+        for (int i = multiplicity(current); i > 0; i--) {
+          visit(pool[current].value);
+        }
+        current = pool[current].right_child;
+        continue;
+      }
+
+      uint32_t predecessor = pool[current].left_child;
+      while (pool[predecessor].right_child != NIL and pool[predecessor].right_child != current) {
+        predecessor = pool[predecessor].right_child;
+      }
+
+      if (pool[predecessor].right_child == NIL) {
+        // First visit - thread the way back and descend left
+        pool[predecessor].right_child = current;
+        current = pool[current].left_child;
+      } else {
+        // Second visit - left subtree done, remove the thread
+        pool[predecessor].right_child = NIL;
+        for (int i = multiplicity(current); i > 0; i--) {
+          visit(pool[current].value);
+        }
+        current = pool[current].right_child;
+      }
+    }
+  }
+
+  /**
+   *  Prints the values in sorted order.
+   */
+  void inorder() {
+    for_each_inorder([](int value) { cout << value << endl; });
+  }
+
+  /**
+   *  Returns all keys in sorted order.
+   */
+  vector<int> sorted_keys() {
+    vector<int> sorted;
+    sorted.reserve(size());
+    for_each_inorder([&sorted](int value) { sorted.push_back(value); });
+    return sorted;
   }
 
-  delete root;
+  /**
+   *  Compiles the current keys into a read-only eytzinger_index
+   *  (defined below). Later inserts are not reflected in the index.
+   */
+  class eytzinger_index freeze();
+
+  /**
+   *  Same as freeze, but compiles the keys into a learned_index.
+   */
+  class learned_index freeze_learned();
+
+  /**
+   *  Removes all keys. O(1) - the pool is released in one piece.
+   */
+  void clear() {
+    pool.clear();
+    vector<uint32_t>().swap(counts);
+    root = NIL;
+    num_keys = 0;
+  }
+
+  /**
+   *  Number of keys, repeated keys included.
+   */
+  int size() const {
+    return num_keys;
+  }
+
+  /**
+   *  Number of nodes in the tree.
+   */
+  int nodes() const {
+    return pool.size();
+  }
+
+  /**
+   *  Bytes used by the nodes and the counts.
+   */
+  size_t memory_bytes() const {
+    return pool.size() * sizeof(node) + counts.size() * sizeof(uint32_t);
+  }
+
+  /**
+   *  Returns the number of levels in the tree (level-order walk).
+   */
+  int depth() const {
+    vector<uint32_t> level;
+    if (root != NIL) {
+      level.push_back(root);
+    }
+
+    int levels = 0;
+    while (!level.empty()) {
+      vector<uint32_t> next;
+      for (int i = 0; i < (int)level.size(); i++) {
+        const node& n = pool[level[i]];
+        if (n.left_child != NIL) {
+          next.push_back(n.left_child);
+        }
+        if (n.right_child != NIL) {
+          next.push_back(n.right_child);
+        }
+      }
+
+      level.swap(next);
+      levels++;
+    }
+
+    return levels;
+  }
+};
+
+
+/**
+ *  Splay tree - a self-adjusting binary search tree for skewed access
+ *  patterns. Every insert and find moves the accessed key to the root
+ *  (top-down splaying), so frequently requested keys stay near the top.
+ *  Nodes live in a node_pool like in bstree, and splaying is iterative:
+ *  the nodes smaller and larger than x are collected in two side trees
+ *  that are attached to the new root at the end.
+ *
+ *  Operations:
+ *    - Insert and find complexity: O(log n) amortised,
+ *      O(log(1 / p)) for a key requested with frequency p.
+ *    - Inorder traversal: O(n).
+ */
+class splay_tree {
+private:
+  static const uint32_t NIL = node_pool<node>::NIL;
+
+  node_pool<node> pool;
+  uint32_t root;
+
+  /**
+   *  Brings the node with x, or the last node on the search path of x,
+   *  to the root.
+   */
+  void splay(int x) {
+    if (root == NIL) {
+      return;
+    }
+
+    // Side trees: nodes known to be smaller (left) and larger (right) than x.
+    // The tails are where the next node gets attached.
+    uint32_t left_root = NIL, left_tail = NIL;
+    uint32_t right_root = NIL, right_tail = NIL;
+    uint32_t current = root;
+
+    while (true) {
+      if (x < pool[current].value) {
+        uint32_t child = pool[current].left_child;
+        if (child == NIL) {
+          break;
+        }
+        if (x < pool[child].value) {
+          // Zig-zig - rotate right first
+          pool[current].left_child = pool[child].right_child;
+          pool[child].right_child = current;
+          current = child;
+          if (pool[current].left_child == NIL) {
+            break;
+          }
+        }
+
+        // Link current into the right tree
+        if (right_root == NIL) {
+          right_root = current;
+        } else {
+          pool[right_tail].left_child = current;
+        }
+        right_tail = current;
+        current = pool[current].left_child;
+
+      } else if (x > pool[current].value) {
+        uint32_t child = pool[current].right_child;
+        if (child == NIL) {
+          break;
+        }
+        if (x > pool[child].value) {
+          // Zag-zag - rotate left first
+          pool[current].right_child = pool[child].left_child;
+          pool[child].left_child = current;
+          current = child;
+          if (pool[current].right_child == NIL) {
+            break;
+          }
+        }
+
+        // Link current into the left tree
+        if (left_root == NIL) {
+          left_root = current;
+        } else {
+          pool[left_tail].right_child = current;
+        }
+        left_tail = current;
+        current = pool[current].right_child;
+
+      } else {
+        break;
+      }
+    }
+
+    // Assemble: the subtrees of current go under the side trees,
+    // the side trees become the children of current
+    if (left_root != NIL) {
+      pool[left_tail].right_child = pool[current].left_child;
+      pool[current].left_child = left_root;
+    }
+    if (right_root != NIL) {
+      pool[right_tail].left_child = pool[current].right_child;
+      pool[current].right_child = right_root;
+    }
+    root = current;
+  }
+
+public:
+  splay_tree () {
+    root = NIL;
+  }
+
+  /**
+   *  Inserts x and makes it the root. Duplicates are kept.
+   */
+  void insert(int x) {
+    uint32_t fresh = pool.allocate(node(x));
+    splay(x);
+
+    if (root != NIL) {
+      node& top = pool[root];
+      node& inserted = pool[fresh];
+
+      if (x <= top.value) {
+        inserted.left_child = top.left_child;
+        inserted.right_child = root;
+        top.left_child = NIL;
+      } else {
+        inserted.right_child = top.right_child;
+        inserted.left_child = root;
+        top.right_child = NIL;
+      }
+    }
+
+    root = fresh;
+  }
+
+  /**
+   *  Returns true if x is in the tree. Not const - the search path is splayed.
+   */
+  bool find(int x) {
+    splay(x);
+    return root != NIL and pool[root].value == x;
+  }
+
+  /**
+   *  Prints the values in sorted order (explicit stack).
+   */
+  void inorder() const {
+    vector<uint32_t> stack;
+    uint32_t current = root;
+
+    while (current != NIL or !stack.empty()) {
+      while (current != NIL) {
+        stack.push_back(current);
+        current = pool[current].left_child;
+      }
+
+      current = stack.back();
+      stack.pop_back();
+      cout << pool[current].value << endl;
+      current = pool[current].right_child;
+    }
+  }
+
+  /**
+   *  Returns the number of levels in the tree (level-order walk).
+   */
+  int depth() const {
+    vector<uint32_t> level;
+    if (root != NIL) {
+      level.push_back(root);
+    }
+
+    int levels = 0;
+    while (!level.empty()) {
+      vector<uint32_t> next;
+      for (int i = 0; i < (int)level.size(); i++) {
+        const node& n = pool[level[i]];
+        if (n.left_child != NIL) {
+          next.push_back(n.left_child);
+        }
+        if (n.right_child != NIL) {
+          next.push_back(n.right_child);
+        }
+      }
+
+      level.swap(next);
+      levels++;
+    }
+
+    return levels;
+  }
+};
+
+
+/**
+ *  Allocator returning storage aligned to a 64-byte cache line,
+ *  so that element 0 of a vector using it starts a line.
+ */
+template <class T>
+class cache_aligned_allocator {
+public:
+  typedef T value_type;
+  static const size_t ALIGNMENT = 64;
+
+  cache_aligned_allocator () {
+  }
+
+  template <class U>
+  cache_aligned_allocator (const cache_aligned_allocator<U>&) {
+  }
+
+  T* allocate(size_t count) {
+    return (T*)::operator new(count * sizeof(T), align_val_t(ALIGNMENT));
+  }
+
+  void deallocate(T* pointer, size_t) {
+    ::operator delete(pointer, align_val_t(ALIGNMENT));
+  }
+
+  template <class U>
+  bool operator== (const cache_aligned_allocator<U>&) const {
+    return true;
+  }
+
+  template <class U>
+  bool operator!= (const cache_aligned_allocator<U>&) const {
+    return false;
+  }
+};
+
+
+/**
+ *  Read-only search index over a frozen set of keys.
+ *  The keys are stored in Eytzinger (BFS) order: the children of the
+ *  element at index k are at 2k and 2k + 1 (1-based), so the top levels of
+ *  the implicit tree share a few cache lines and the descent needs no pointers.
+ *
+ *  The search is branchless: every step goes to 2k + (key < x) and
+ *  prefetches the cache line holding the descendants PREFETCH_LEVELS below,
+ *  so the memory accesses of the next levels overlap with the comparisons.
+ *
+ *  Operations:
+ *    - Build complexity: O(n) from sorted keys.
+ *    - Find complexity: O(log n), one comparison per level.
+ */
+class eytzinger_index {
+private:
+  // 16 ints fill one 64-byte cache line: the descendants 4 levels
+  // below k are the 16 consecutive elements starting at 16k, and
+  // since keys[0] starts a line, so does keys[16k].
+  static const int PREFETCH_LEVELS = 4;
+
+  vector<int, cache_aligned_allocator<int>> keys; // keys[0] is unused
+  size_t n;
+
+  /**
+   *  Places sorted[*next...] into the subtree rooted at k by an inorder
+   *  walk of the implicit tree. Recursion depth is O(log n).
+   */
+  void place(const vector<int>& sorted, size_t& next, size_t k) {
+    if (k > n) {
+      return;
+    }
+
+    place(sorted, next, 2 * k);
+    keys[k] = sorted[next++];
+    place(sorted, next, 2 * k + 1);
+  }
+
+public:
+  eytzinger_index () {
+    n = 0;
+    keys.resize(1);
+  }
+
+  /**
+   *  Builds the index from keys sorted in non-decreasing order.
+   */
+  explicit eytzinger_index (const vector<int>& sorted) {
+    n = sorted.size();
+    keys.resize(n + 1);
+
+    size_t next = 0;
+    place(sorted, next, 1);
+  }
+
+  bool find(int x) const {
+    const int* data = keys.data();
+    size_t k = 1;
+
+    while (k <= n) {
+      __builtin_prefetch(data + (k << PREFETCH_LEVELS));
+      k = 2 * k + (data[k] < x);
+    }
+
+    // The path ends below the leaf; the last left turn marks the
+    // smallest key >= x. Strip the trailing right turns (ones) and that turn.
+    k >>= __builtin_ffsll(~k);
+    return k != 0 and data[k] == x;
+  }
+
+  int size() const {
+    return n;
+  }
+
+  /**
+   *  Number of levels of the implicit tree.
+   */
+  int depth() const {
+    int levels = 0;
+    for (size_t k = n; k > 0; k >>= 1) {
+      levels++;
+    }
+    return levels;
+  }
+};
+
+
+eytzinger_index bstree::freeze() {
+  return eytzinger_index(sorted_keys());
+}
+
+
+/**
+ *  Learned index over a frozen, sorted set of keys.
+ *  The position of a key in the sorted array is approximated by a
+ *  piecewise-linear function of the key. Segments are built greedily
+ *  (shrinking cone): a segment grows while some slope keeps every one of
+ *  its keys within EPSILON positions of the prediction. A lookup finds
+ *  the segment of x, predicts a position and binary searches only the
+ *  2 * EPSILON + 3 keys around it.
+ *  For near-uniform keys (e.g. timestamps) a few segments cover millions
+ *  of keys, so the index costs a fraction of a byte per key.
+ *
+ *  Operations:
+ *    - Build complexity: O(n) from sorted keys.
+ *    - Find complexity: O(log s + log EPSILON) for s segments.
+ */
+class learned_index {
+private:
+  static const int EPSILON = 16;  // Maximum prediction error in positions
+
+  class segment {
+  public:
+    int first_key;
+    int first_pos;
+    double slope;
+  };
+
+  vector<int> keys;       // Distinct keys in sorted order
+  vector<segment> segments;
+  vector<int> first_keys; // first_keys[i] = segments[i].first_key, searched on its own
+
+public:
+  learned_index () {
+  }
+
+  /**
+   *  Builds the index from keys sorted in non-decreasing order.
+   *  Repeated keys are stored once.
+   */
+  explicit learned_index (const vector<int>& sorted) {
+    for (int i = 0; i < (int)sorted.size(); i++) {
+      if (i == 0 or sorted[i] != sorted[i - 1]) {
+        keys.push_back(sorted[i]);
+      }
+    }
+
+    int n = keys.size();
+    int start = 0;
+    while (start < n) {
+      // Feasible slopes for the current segment: [low, high]
+      double low = 0, high = 1e300;
+      int end = start + 1;
+
+      for (; end < n; end++) {
+        double dx = (double)keys[end] - keys[start];
+        double dy = end - start;
+        double slope = dy / dx;
+
+        if (slope < low or slope > high) {
+          break;  // This key cannot join the segment
+        }
+        low = max(low, (dy - EPSILON) / dx);
+        high = min(high, (dy + EPSILON) / dx);
+      }
+
+      double slope = (end == start + 1) ? 0 : (low + high) / 2;
+      segments.push_back({keys[start], start, slope});
+      first_keys.push_back(keys[start]);
+      start = end;
+    }
+  }
+
+  bool find(int x) const {
+    if (keys.empty() or x < keys[0]) {
+      return false;
+    }
+
+    // Last segment starting at or before x (branchless, first_keys[0] <= x)
+    const int* first = first_keys.data();
+    int length = first_keys.size();
+    while (length > 1) {
+      int half = length / 2;
+      first = (first[half] <= x) ? first + half : first;
+      length -= half;
+    }
+    const segment& seg = segments[first - first_keys.data()];
+
+    long long predicted = seg.first_pos + (long long)(seg.slope * ((double)x - seg.first_key));
+    long long from = max(0LL, predicted - EPSILON - 1);
+    long long to = min((long long)keys.size(), predicted + EPSILON + 2);
+    if (from >= to) {
+      return false;
+    }
+
+    // Branchless search in the window, so that consecutive lookups
+    // are not serialised by mispredicted branches
+    const int* base = keys.data() + from;
+    long long remaining = to - from;
+    while (remaining > 1) {
+      long long half = remaining / 2;
+      base = (base[half] <= x) ? base + half : base;
+      remaining -= half;
+    }
+
+    return *base == x;
+  }
+
+  int size() const {
+    return keys.size();
+  }
+
+  int num_segments() const {
+    return segments.size();
+  }
+
+  /**
+   *  Bytes used by the model, without the keys themselves.
+   */
+  size_t index_bytes() const {
+    return segments.size() * sizeof(segment) + first_keys.size() * sizeof(int);
+  }
+};
+
+
+learned_index bstree::freeze_learned() {
+  return learned_index(sorted_keys());
+}
+
+
+/**
+ *  Self-balancing (AVL) variant of the binary search tree.
+ *  The heights of the two subtrees of every node differ by at most one,
+ *  so the depth of the tree is O(log n) regardless of the insertion order.
+ *
+ *  Every node also stores the size of its subtree, which answers
+ *  order-statistic queries (rank, select, range counts) in O(log n).
+ *
+ *  Operations:
+ *    - Insert operation complexity: O(log n).
+ *    - Erase operation complexity: O(log n).
+ *    - Find, rank, select and count_range complexity: O(log n).
+ */
+class avl_node {
+public:
+  int value;
+  int height;   // Height of the subtree rooted at this node (leaf has height 1)
+  int size;     // Number of nodes in the subtree rooted at this node
+  avl_node* left_child;
+  avl_node* right_child;
+
+  avl_node (int value) {
+    this->value = value;
+    height = 1;
+    size = 1;
+    left_child = NULL;
+    right_child = NULL;
+  }
+};
+
+
+class avl_tree {
+private:
+  static const int PARALLEL_GRAIN = 20000; // Smallest set operation worth a thread
+
+  avl_node* root;
+
+  static int get_height(avl_node* x) {
+    return (x == NULL) ? 0 : x->height;
+  }
+
+  static int get_size(avl_node* x) {
+    return (x == NULL) ? 0 : x->size;
+  }
+
+  static int balance_factor(avl_node* x) {
+    return get_height(x->left_child) - get_height(x->right_child);
+  }
+
+  /**
+   *  Recalculates the height and the size of x from its children.
+   */
+  static void recalc(avl_node* x) {
+    x->height = 1 + max(get_height(x->left_child), get_height(x->right_child));
+    x->size = 1 + get_size(x->left_child) + get_size(x->right_child);
+  }
+
+  /**
+   *  Rotates the subtree rooted at x to the right.
+   *  Returns the new root of the subtree (the former left child).
+   */
+  static avl_node* rotate_right(avl_node* x) {
+    avl_node* y = x->left_child;
+    x->left_child = y->right_child;
+    y->right_child = x;
+
+    recalc(x);
+    recalc(y);
+    return y;
+  }
+
+  /**
+   *  Rotates the subtree rooted at x to the left.
+   *  Returns the new root of the subtree (the former right child).
+   */
+  static avl_node* rotate_left(avl_node* x) {
+    avl_node* y = x->right_child;
+    x->right_child = y->left_child;
+    y->left_child = x;
+
+    recalc(x);
+    recalc(y);
+    return y;
+  }
+
+  /**
+   *  Restores the AVL property at x after one of its subtrees
+   *  changed its height by one. Returns the new root of the subtree.
+   */
+  static avl_node* rebalance(avl_node* x) {
+    recalc(x);
+    int balance = balance_factor(x);
+
+    if (balance > 1) {
+      // Left heavy
+      if (balance_factor(x->left_child) < 0) {
+        // Left-right case
+        x->left_child = rotate_left(x->left_child);
+      }
+      return rotate_right(x);
+    }
+    if (balance < -1) {
+      // Right heavy
+      if (balance_factor(x->right_child) > 0) {
+        // Right-left case
+        x->right_child = rotate_right(x->right_child);
+      }
+      return rotate_left(x);
+    }
+
+    return x;
+  }
+
+  /**
+   *  Inserts x in the subtree rooted at current and
+   *  returns the new root of that subtree.
+   *  Duplicates go to the left subtree, same as in node::insert.
+   */
+  static avl_node* insert(avl_node* current, int x) {
+    if (current == NULL) {
+      return new avl_node(x);
+    }
+
+    if (x <= current->value) {
+      current->left_child = insert(current->left_child, x);
+    } else {
+      current->right_child = insert(current->right_child, x);
+    }
+
+    return rebalance(current);
+  }
+
+  /**
+   *  Unlinks the smallest node of the subtree rooted at current and
+   *  stores it in *removed. Returns the new root of the subtree.
+   */
+  static avl_node* detach_min(avl_node* current, avl_node** removed) {
+    if (current->left_child == NULL) {
+      *removed = current;
+      return current->right_child;
+    }
+
+    current->left_child = detach_min(current->left_child, removed);
+    return rebalance(current);
+  }
+
+  /**
+   *  Removes one occurrence of x from the subtree rooted at current and
+   *  returns the new root of that subtree. Sets erased if x was found.
+   *  A node with two children is replaced by its inorder successor.
+   */
+  static avl_node* erase(avl_node* current, int x, bool& erased) {
+    if (current == NULL) {
+      return NULL;
+    }
+
+    if (x < current->value) {
+      current->left_child = erase(current->left_child, x, erased);
+    } else if (x > current->value) {
+      current->right_child = erase(current->right_child, x, erased);
+    } else {
+      erased = true;
+      avl_node* left = current->left_child;
+      avl_node* right = current->right_child;
+      delete current;
+
+      if (left == NULL) {
+        return right;
+      }
+      if (right == NULL) {
+        return left;
+      }
+
+      avl_node* successor;
+      right = detach_min(right, &successor);
+      successor->left_child = left;
+      successor->right_child = right;
+      current = successor;
+    }
+
+    return rebalance(current);
+  }
+
+  static void inorder(avl_node* current) {
+    if (current == NULL) {
+      return;
+    }
+
+    inorder(current->left_child);
+    cout << current->value << endl;
+    inorder(current->right_child);
+  }
+
+
+  // ======================  Join-based set operations  ======================
+  //
+  // All of them consume their input subtrees and return the result.
+  // The keys of each input are expected to be distinct (sets).
+
+
+  /**
+   *  Joins left, the single node middle and right, where all keys of left
+   *  are <= middle->value <= all keys of right, into one AVL tree.
+   *  Descends along the spine of the taller tree to the first subtree whose
+   *  height is within one of the shorter tree and rebalances on the way up.
+   *  Complexity: O(|height(left) - height(right)| + 1).
+   */
+  static avl_node* join(avl_node* left, avl_node* middle, avl_node* right) {
+    if (get_height(left) > get_height(right) + 1) {
+      left->right_child = join(left->right_child, middle, right);
+      return rebalance(left);
+    }
+    if (get_height(right) > get_height(left) + 1) {
+      right->left_child = join(left, middle, right->left_child);
+      return rebalance(right);
+    }
+
+    middle->left_child = left;
+    middle->right_child = right;
+    recalc(middle);
+    return middle;
+  }
+
+  /**
+   *  Joins two trees without a middle key, using the largest key of left.
+   */
+  static avl_node* join(avl_node* left, avl_node* right) {
+    if (left == NULL) {
+      return right;
+    }
+
+    avl_node* last;
+    left = detach_max(left, &last);
+    return join(left, last, right);
+  }
+
+  /**
+   *  Unlinks the largest node of the subtree rooted at current and
+   *  stores it in *removed. Returns the new root of the subtree.
+   */
+  static avl_node* detach_max(avl_node* current, avl_node** removed) {
+    if (current->right_child == NULL) {
+      *removed = current;
+      return current->left_child;
+    }
+
+    current->right_child = detach_max(current->right_child, removed);
+    return rebalance(current);
+  }
+
+  /**
+   *  Splits the subtree rooted at current into the keys smaller than x
+   *  (*less), the node holding x (returned, NULL if absent), and the keys
+   *  greater than x (*greater). Complexity: O(log n).
+   */
+  static avl_node* split(avl_node* current, int x, avl_node** less, avl_node** greater) {
+    if (current == NULL) {
+      *less = NULL;
+      *greater = NULL;
+      return NULL;
+    }
+
+    avl_node* left = current->left_child;
+    avl_node* right = current->right_child;
+
+    if (x == current->value) {
+      *less = left;
+      *greater = right;
+      return current;
+    }
+
+    avl_node* found;
+    if (x < current->value) {
+      found = split(left, x, less, greater);
+      *greater = join(*greater, current, right);
+    } else {
+      found = split(right, x, less, greater);
+      *less = join(left, current, *less);
+    }
+    return found;
+  }
+
+  static avl_node* set_union(avl_node* a, avl_node* b, int fork_depth) {
+    if (a == NULL) {
+      return b;
+    }
+    if (b == NULL) {
+      return a;
+    }
+
+    int keys = get_size(a) + get_size(b);
+    avl_node *b_less, *b_greater;
+    delete split(b, a->value, &b_less, &b_greater);  // The copy from b is not needed
+
+    avl_node *left, *right;
+    fork_join(fork_depth, keys, PARALLEL_GRAIN,
+      [&]() { left = set_union(a->left_child, b_less, fork_depth - 1); },
+      [&]() { right = set_union(a->right_child, b_greater, fork_depth - 1); });
+
+    return join(left, a, right);
+  }
+
+  static avl_node* set_intersection(avl_node* a, avl_node* b, int fork_depth) {
+    if (a == NULL or b == NULL) {
+      destroy(a);
+      destroy(b);
+      return NULL;
+    }
+
+    int keys = get_size(a) + get_size(b);
+    avl_node *b_less, *b_greater;
+    avl_node* match = split(b, a->value, &b_less, &b_greater);
+    bool found = (match != NULL);
+    delete match;
+
+    avl_node *left, *right;
+    fork_join(fork_depth, keys, PARALLEL_GRAIN,
+      [&]() { left = set_intersection(a->left_child, b_less, fork_depth - 1); },
+      [&]() { right = set_intersection(a->right_child, b_greater, fork_depth - 1); });
+
+    if (found) {
+      return join(left, a, right);
+    }
+    delete a;
+    return join(left, right);
+  }
+
+  /**
+   *  Keys of a that are not in b.
+   */
+  static avl_node* set_difference(avl_node* a, avl_node* b, int fork_depth) {
+    if (a == NULL or b == NULL) {
+      destroy(b);
+      return a;
+    }
+
+    avl_node *a_less, *a_greater;
+    delete split(a, b->value, &a_less, &a_greater);  // Removed from the result
+
+    avl_node *left, *right;
+    fork_join(fork_depth, get_size(a_less) + get_size(a_greater) + get_size(b), PARALLEL_GRAIN,
+      [&]() { left = set_difference(a_less, b->left_child, fork_depth - 1); },
+      [&]() { right = set_difference(a_greater, b->right_child, fork_depth - 1); });
+
+    delete b;
+    return join(left, right);
+  }
+
+  static void collect(avl_node* current, vector<int>& out) {
+    if (current == NULL) {
+      return;
+    }
+
+    collect(current->left_child, out);
+    out.push_back(current->value);
+    collect(current->right_child, out);
+  }
+
+  static void destroy(avl_node* current) {
+    if (current == NULL) {
+      return;
+    }
+
+    destroy(current->left_child);
+    destroy(current->right_child);
+    delete current;
+  }
+
+public:
+  avl_tree () {
+    root = NULL;
+  }
+
+  ~avl_tree () {
+    destroy(root);
+  }
+
+  avl_tree (const avl_tree&) = delete;
+  avl_tree& operator=(const avl_tree&) = delete;
+
+  /**
+   *  Set operations in the style of Blelloch et al. ("Just join for parallel
+   *  ordered sets"): split one tree by the root key of the other, solve the
+   *  two halves independently - in parallel on up to threads threads -
+   *  and join the results.
+   *  Both trees must hold distinct keys. The result replaces this tree and
+   *  other is left empty.
+   *  Complexity: O(m log(n / m + 1)) work for sizes m <= n, O(log^2 n) span.
+   */
+  void unite(avl_tree& other, int threads = 1) {
+    root = set_union(root, other.root, fork_depth_for(threads));
+    other.root = NULL;
+  }
+
+  void intersect(avl_tree& other, int threads = 1) {
+    root = set_intersection(root, other.root, fork_depth_for(threads));
+    other.root = NULL;
+  }
+
+  /**
+   *  Removes the keys of other from this tree.
+   */
+  void subtract(avl_tree& other, int threads = 1) {
+    root = set_difference(root, other.root, fork_depth_for(threads));
+    other.root = NULL;
+  }
+
+  /**
+   *  Returns all keys in sorted order.
+   */
+  vector<int> sorted_keys() const {
+    vector<int> out;
+    out.reserve(size());
+    collect(root, out);
+    return out;
+  }
+
+  void insert(int x) {
+    root = insert(root, x);
+  }
+
+  bool find(int x) const {
+    avl_node* current = root;
+
+    while (current != NULL) {
+      if (current->value == x) {
+        return true;
+      }
+      current = (x < current->value) ? current->left_child : current->right_child;
+    }
+
+    return false;
+  }
+
+  /**
+   *  Removes one occurrence of x. Returns false if x is not in the tree.
+   */
+  bool erase(int x) {
+    bool erased = false;
+    root = erase(root, x, erased);
+    return erased;
+  }
+
+  /**
+   *  Returns the number of keys smaller than x.
+   */
+  int rank(int x) const {
+    int result = 0;
+    avl_node* current = root;
+
+    while (current != NULL) {
+      if (current->value < x) {
+        // The node and its whole left subtree are smaller
+        result += get_size(current->left_child) + 1;
+        current = current->right_child;
+      } else {
+        current = current->left_child;
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   *  Returns the number of keys smaller than or equal to x.
+   */
+  int rank_upper(int x) const {
+    int result = 0;
+    avl_node* current = root;
+
+    while (current != NULL) {
+      if (current->value <= x) {
+        result += get_size(current->left_child) + 1;
+        current = current->right_child;
+      } else {
+        current = current->left_child;
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   *  Finds the k-th smallest key (0-based, duplicates counted).
+   *  Returns false if k is out of range.
+   */
+  bool select(int k, int& result) const {
+    if (k < 0 or k >= size()) {
+      return false;
+    }
+
+    avl_node* current = root;
+    while (true) {
+      int left_size = get_size(current->left_child);
+
+      if (k < left_size) {
+        current = current->left_child;
+      } else if (k == left_size) {
+        result = current->value;
+        return true;
+      } else {
+        k -= left_size + 1;
+        current = current->right_child;
+      }
+    }
+  }
+
+  /**
+   *  Returns the number of keys in the range [lo, hi].
+   */
+  int count_range(int lo, int hi) const {
+    if (lo > hi) {
+      return 0;
+    }
+    return rank_upper(hi) - rank(lo);
+  }
+
+  int size() const {
+    return get_size(root);
+  }
+
+  void inorder() {
+    inorder(root);
+  }
+
+  /**
+   *  Returns the number of levels in the tree.
+   */
+  int depth() {
+    return get_height(root);
+  }
+};
+
+
+/**
+ *  B+-tree engine with cache-line-sized nodes.
+ *  A leaf is exactly one 64-byte line holding up to BPLUS_KEYS = 15 keys
+ *  and their count. An internal node is two adjacent lines: the same key
+ *  line, then a line with its 16 child indices. The descent prefetches the
+ *  child line while it searches the key line, so both lines are in flight
+ *  together and each level costs about one miss of latency - one level of
+ *  the 16-way tree stands for four levels of a binary tree. Keys are stored
+ *  only in the leaves; the order of the leaves is kept for inorder.
+ *
+ *  The position inside a key line is found with two 8-lane AVX2 compares:
+ *  the movemask of (key > x) gives one bit per key, and the popcount of the
+ *  remaining bits is the number of keys <= x - no branches per key.
+ *
+ *  Operations:
+ *    - Insert operation complexity: O(log n).
+ *    - Find operation complexity: O(log n), ~log_16(n) levels.
+ */
+static const int BPLUS_KEYS = 15;
+
+/**
+ *  One cache line of up to BPLUS_KEYS sorted keys (separators in internal
+ *  nodes). The count takes the 16th lane, which the in-use mask of the
+ *  vector search always leaves out.
+ */
+class alignas(64) bplus_keys {
+public:
+  int keys[BPLUS_KEYS];
+  int count;                        // Number of keys in use
+
+  bplus_keys () {
+    for (int i = 0; i < BPLUS_KEYS; i++) {
+      keys[i] = INT_MAX;
+    }
+    count = 0;
+  }
+
+  /**
+   *  Returns the number of keys <= x, i.e. the index of the child to
+   *  descend into, or the insert position in a leaf.
+   */
+  int count_less_equal(int x) const {
+#ifdef __AVX2__
+    __m256i needle = _mm256_set1_epi32(x);
+    __m256i low = _mm256_load_si256((const __m256i*)keys);
+    __m256i high = _mm256_load_si256((const __m256i*)(keys + 8));
+
+    unsigned greater = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(low, needle)))
+                     | (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(high, needle))) << 8);
+    unsigned in_use = (1u << count) - 1;
+    return __builtin_popcount(~greater & in_use);
+#else
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+      result += (keys[i] <= x);
+    }
+    return result;
+#endif
+  }
+
+  bool contains(int x) const {
+#ifdef __AVX2__
+    __m256i needle = _mm256_set1_epi32(x);
+    __m256i low = _mm256_load_si256((const __m256i*)keys);
+    __m256i high = _mm256_load_si256((const __m256i*)(keys + 8));
+
+    unsigned equal = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(low, needle)))
+                   | (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(high, needle))) << 8);
+    return (equal & ((1u << count) - 1)) != 0;
+#else
+    for (int i = 0; i < count; i++) {
+      if (keys[i] == x) {
+        return true;
+      }
+    }
+    return false;
+#endif
+  }
+};
+
+static_assert(sizeof(bplus_keys) == 64, "a B+-tree key line should fill one cache line");
+
+/**
+ *  Internal node: its key line followed by the line of its children.
+ */
+class alignas(64) bplus_inner {
+public:
+  bplus_keys line;
+  uint32_t children[BPLUS_KEYS + 1];
+
+  bplus_inner () {
+    for (int i = 0; i <= BPLUS_KEYS; i++) {
+      children[i] = node_pool<bplus_inner>::NIL;
+    }
+  }
+};
+
+static_assert(sizeof(bplus_inner) == 128, "a B+-tree internal node should fill two cache lines");
+
+
+class bplus_tree {
+private:
+  static constexpr uint32_t NIL = node_pool<bplus_inner>::NIL;
+
+  node_pool<bplus_keys> leaves;
+  node_pool<bplus_inner> inners;
+  vector<uint32_t> next_leaf;  // next_leaf[id] - the leaf to the right of leaf id
+  uint32_t root;               // A leaf if levels == 1, else an internal node
+  int levels;
+
+  /**
+   *  Describes the outcome of inserting into a subtree:
+   *  if the subtree root was split, right is the new right sibling
+   *  and separator the smallest key routed to it.
+   */
+  struct split_result {
+    uint32_t right;
+    int separator;
+  };
+
+  uint32_t new_leaf() {
+    uint32_t id = leaves.allocate(bplus_keys());
+    if (next_leaf.size() <= id) {
+      next_leaf.resize(id + 1, NIL);
+    }
+    return id;
+  }
+
+  /**
+   *  Inserts x in the leaf id. A full leaf is split in half.
+   *  Equal keys are appended after the existing ones.
+   */
+  split_result insert_leaf(uint32_t id, int x) {
+    int pos = leaves[id].count_less_equal(x);
+
+    if (leaves[id].count < BPLUS_KEYS) {
+      bplus_keys& leaf = leaves[id];
+      for (int i = leaf.count; i > pos; i--) {
+        leaf.keys[i] = leaf.keys[i - 1];
+      }
+      leaf.keys[pos] = x;
+      leaf.count++;
+      return {NIL, 0};
+    }
+
+    // Full - merge the new key into a temporary array and split it
+    int merged[BPLUS_KEYS + 1];
+    for (int i = 0, j = 0; i <= BPLUS_KEYS; i++) {
+      merged[i] = (i == pos) ? x : leaves[id].keys[j++];
+    }
+
+    uint32_t right_id = new_leaf();
+    bplus_keys& left = leaves[id];
+    bplus_keys& right = leaves[right_id];
+
+    int half = (BPLUS_KEYS + 1) / 2;
+    left.count = half;
+    right.count = BPLUS_KEYS + 1 - half;
+    for (int i = 0; i < BPLUS_KEYS; i++) {
+      left.keys[i] = (i < left.count) ? merged[i] : INT_MAX;
+      right.keys[i] = (i < right.count) ? merged[half + i] : INT_MAX;
+    }
+
+    next_leaf[right_id] = next_leaf[id];
+    next_leaf[id] = right_id;
+    return {right_id, right.keys[0]};
+  }
+
+  /**
+   *  Inserts x in the subtree rooted at id, level levels above the leaves
+   *  (1 for a leaf). An internal node that overflows is split around its
+   *  middle separator, which moves up.
+   */
+  split_result insert(uint32_t id, int level, int x) {
+    if (level == 1) {
+      return insert_leaf(id, x);
+    }
+
+    int pos = inners[id].line.count_less_equal(x);
+    split_result child = insert(inners[id].children[pos], level - 1, x);
+    if (child.right == NIL) {
+      return child;
+    }
+
+    if (inners[id].line.count < BPLUS_KEYS) {
+      bplus_inner& current = inners[id];
+      for (int i = current.line.count; i > pos; i--) {
+        current.line.keys[i] = current.line.keys[i - 1];
+        current.children[i + 1] = current.children[i];
+      }
+      current.line.keys[pos] = child.separator;
+      current.children[pos + 1] = child.right;
+      current.line.count++;
+      return {NIL, 0};
+    }
+
+    // Full - merge the new separator and child, then split
+    int merged_keys[BPLUS_KEYS + 1];
+    uint32_t merged_children[BPLUS_KEYS + 2];
+    merged_children[0] = inners[id].children[0];
+    for (int i = 0, j = 0; i <= BPLUS_KEYS; i++) {
+      if (i == pos) {
+        merged_keys[i] = child.separator;
+        merged_children[i + 1] = child.right;
+      } else {
+        merged_keys[i] = inners[id].line.keys[j];
+        merged_children[i + 1] = inners[id].children[j + 1];
+        j++;
+      }
+    }
+
+    uint32_t right_id = inners.allocate(bplus_inner());
+    bplus_inner& left = inners[id];
+    bplus_inner& right = inners[right_id];
+
+    // Keys [0, half) stay, key half moves up, the rest go right
+    int half = BPLUS_KEYS / 2;
+    left.line.count = half;
+    right.line.count = BPLUS_KEYS - half;
+    for (int i = 0; i < BPLUS_KEYS; i++) {
+      left.line.keys[i] = (i < left.line.count) ? merged_keys[i] : INT_MAX;
+      right.line.keys[i] = (i < right.line.count) ? merged_keys[half + 1 + i] : INT_MAX;
+    }
+    for (int i = 0; i <= BPLUS_KEYS; i++) {
+      left.children[i] = (i <= left.line.count) ? merged_children[i] : NIL;
+      right.children[i] = (i <= right.line.count) ? merged_children[half + 1 + i] : NIL;
+    }
+
+    return {right_id, merged_keys[half]};
+  }
+
+public:
+  bplus_tree () {
+    root = new_leaf();
+    levels = 1;
+  }
+
+  void insert(int x) {
+    split_result result = insert(root, levels, x);
+    if (result.right == NIL) {
+      return;
+    }
+
+    // The root was split - grow the tree by one level
+    uint32_t new_root = inners.allocate(bplus_inner());
+    bplus_inner& top = inners[new_root];
+    top.line.keys[0] = result.separator;
+    top.line.count = 1;
+    top.children[0] = root;
+    top.children[1] = result.right;
+
+    root = new_root;
+    levels++;
+  }
+
+  bool find(int x) const {
+    uint32_t current = root;
+
+    for (int level = levels; level > 1; level--) {
+      const bplus_inner& n = inners[current];
+      __builtin_prefetch(n.children);  // The second line, fetched alongside the keys
+      current = n.children[n.line.count_less_equal(x)];
+    }
+
+    return leaves[current].contains(x);
+  }
+
+  /**
+   *  Prints the values in sorted order by following the leaf chain.
+   */
+  void inorder() const {
+    uint32_t current = root;
+    for (int level = levels; level > 1; level--) {
+      current = inners[current].children[0];
+    }
+
+    for (; current != NIL; current = next_leaf[current]) {
+      const bplus_keys& leaf = leaves[current];
+      for (int i = 0; i < leaf.count; i++) {
+        cout << leaf.keys[i] << endl;
+      }
+    }
+  }
+
+  int depth() const {
+    return levels;
+  }
+};
+
+
+/**
+ *  Read-only B+-tree stored in a file of fixed-size pages, for key sets
+ *  larger than memory. The file is mapped with mmap and find reads the
+ *  pages straight from the mapping. The operating system loads pages on
+ *  demand and keeps the hot upper levels cached. Opening an index checks
+ *  only the header, so it takes the same time whatever the file size.
+ *
+ *  File layout (integers in host byte order):
+ *    page 0       - disk_bplus_header
+ *    pages 1 ...  - nodes, every node written after its children,
+ *                   so the root is the last page
+ *  A node page starts with its count and level (0 for leaves). A leaf then
+ *  holds count sorted keys. An internal node holds count separators, and
+ *  at a fixed offset after them count + 1 child page numbers.
+ *  Child i holds the keys in [separator i - 1, separator i).
+ *
+ *  The file is written by disk_bplus_tree::writer from keys in sorted order,
+ *  keeping one page per level in memory, so the input may be larger than RAM.
+ *
+ *  Operations:
+ *    - Bulk load complexity: O(n), one sequential write of the file.
+ *    - Open complexity: O(1).
+ *    - Find complexity: O(log n), one page per level, log_B(n) levels
+ *      with B = (page_size - 12) / 8 children per internal page.
+ */
+static const uint32_t DISK_BPLUS_VERSION = 1;
+
+class disk_bplus_header {
+public:
+  char magic[8];       // "BPTREE" padded with zeros
+  uint32_t version;    // DISK_BPLUS_VERSION
+  uint32_t page_size;  // Bytes per page, a power of two
+  uint64_t num_keys;
+  uint64_t num_pages;  // Including the header page
+  uint32_t root;       // Page number of the root
+  uint32_t levels;     // 1 if the root is a leaf
+};
+
+class disk_bplus_tree {
+private:
+  static const uint32_t PAGE_HEADER = 2 * sizeof(uint32_t); // count and level
+  static const uint32_t MIN_PAGE_SIZE = 64;
+  static const uint32_t MAX_PAGE_SIZE = 1 << 20;
+  static const uint32_t MAX_LEVELS = 32;
+
+  const char* base;  // Start of the mapping, NULL when closed
+  size_t length;
+  disk_bplus_header header;
+
+  static uint32_t leaf_capacity(uint32_t page_size) {
+    return (page_size - PAGE_HEADER) / sizeof(int);
+  }
+
+  static uint32_t internal_capacity(uint32_t page_size) {
+    return (page_size - PAGE_HEADER - sizeof(uint32_t)) / (sizeof(int) + sizeof(uint32_t));
+  }
+
+  static bool valid_page_size(uint32_t page_size) {
+    return page_size >= MIN_PAGE_SIZE and page_size <= MAX_PAGE_SIZE and (page_size & (page_size - 1)) == 0;
+  }
+
+  const char* page(uint32_t id) const {
+    return base + (size_t)id * header.page_size;
+  }
+
+  static uint32_t page_count(const char* page) {
+    return ((const uint32_t*)page)[0];
+  }
+
+  static uint32_t page_level(const char* page) {
+    return ((const uint32_t*)page)[1];
+  }
+
+  static const int* page_keys(const char* page) {
+    return (const int*)(page + PAGE_HEADER);
+  }
+
+  /**
+   *  Returns true if page id lies in the file, sits on the given level
+   *  (0 for leaves) and holds no more keys than fit. A damaged file then
+   *  fails a lookup instead of sending it outside the mapping.
+   */
+  bool valid_page(uint32_t id, uint32_t level) const {
+    if (id == 0 or id >= header.num_pages) {
+      return false;
+    }
+    const char* current = page(id);
+    uint32_t capacity = (level == 0) ? leaf_capacity(header.page_size) : internal_capacity(header.page_size);
+    return page_level(current) == level and page_count(current) <= capacity;
+  }
+
+  const uint32_t* page_children(const char* page) const {
+    return (const uint32_t*)(page_keys(page) + internal_capacity(header.page_size));
+  }
+
+  /**
+   *  Returns the number of keys <= x among the count sorted keys.
+   *  Branchless binary search, so the page layout does not cost mispredictions.
+   */
+  static uint32_t count_less_equal(const int* keys, uint32_t count, int x) {
+    const int* first = keys;
+    uint32_t length = count;
+
+    while (length > 0) {
+      uint32_t half = length / 2;
+      bool right = (first[half] <= x);
+      first = right ? first + half + 1 : first;
+      length = right ? length - half - 1 : half;
+    }
+    return first - keys;
+  }
+
+  void inorder(uint32_t id, uint32_t level) const {
+    if (!valid_page(id, level)) {
+      return;
+    }
+    const char* current = page(id);
+    uint32_t count = page_count(current);
+
+    if (level == 0) {
+      for (uint32_t i = 0; i < count; i++) {
+        cout << page_keys(current)[i] << endl;
+      }
+      return;
+    }
+
+    for (uint32_t i = 0; i <= count; i++) {
+      inorder(page_children(current)[i], level - 1);
+    }
+  }
+
+public:
+  /**
+   *  Writes an index file from keys added in non-decreasing order.
+   *  Repeated keys are stored once. Usage: open, add every key, close.
+   *  The pages go to path.tmp, which close syncs and renames over path,
+   *  so a process still mapping the old file keeps reading it intact.
+   */
+  class writer {
+  private:
+    /**
+     *  The page being filled on one level of the tree.
+     */
+    class level_buffer {
+    public:
+      vector<char> page;
+      uint32_t entries;        // Keys in a leaf, children in an internal node
+      uint32_t pages_written;
+      int min_key;             // Smallest key below this page
+    };
+
+    FILE* file;
+    string path;       // The index file, replaced by close
+    string temp_path;  // Where the pages are written until then
+    uint32_t page_size;
+    uint32_t next_page;
+    uint64_t num_keys;
+    int last_key;
+    bool failed;
+    vector<level_buffer> levels;  // levels[0] is the leaf being filled
+
+    void add_level() {
+      level_buffer buffer;
+      buffer.page.assign(page_size, 0);
+      buffer.entries = 0;
+      buffer.pages_written = 0;
+      buffer.min_key = 0;
+      levels.push_back(buffer);
+    }
+
+    /**
+     *  Writes the page of the given level, returns its page number
+     *  and starts an empty page on that level.
+     */
+    uint32_t write_page(int level) {
+      level_buffer& buffer = levels[level];
+      uint32_t* fields = (uint32_t*)buffer.page.data();
+      fields[0] = (level == 0) ? buffer.entries : buffer.entries - 1;
+      fields[1] = level;
+
+      if (fwrite(buffer.page.data(), page_size, 1, file) != 1) {
+        failed = true;
+      }
+
+      fill(buffer.page.begin(), buffer.page.end(), 0);
+      buffer.entries = 0;
+      buffer.pages_written++;
+      return next_page++;
+    }
+
+    /**
+     *  Writes the full page of the given level and adds it to its parent.
+     */
+    void flush(int level) {
+      int min_key = levels[level].min_key;
+      uint32_t id = write_page(level);
+      add_child(level + 1, id, min_key);
+    }
+
+    /**
+     *  Appends the page id, whose smallest key is min_key, to the internal
+     *  page being filled on the given level; min_key becomes the separator
+     *  in front of it.
+     */
+    void add_child(int level, uint32_t id, int min_key) {
+      if (level == (int)levels.size()) {
+        add_level();
+      }
+
+      uint32_t capacity = internal_capacity(page_size);
+      if (levels[level].entries == capacity + 1) {
+        flush(level);
+      }
+
+      level_buffer& buffer = levels[level];
+      int* keys = (int*)(buffer.page.data() + PAGE_HEADER);
+      uint32_t* children = (uint32_t*)(keys + capacity);
+
+      if (buffer.entries == 0) {
+        buffer.min_key = min_key;
+      } else {
+        keys[buffer.entries - 1] = min_key;
+      }
+      children[buffer.entries++] = id;
+    }
+
+  public:
+    writer () {
+      file = NULL;
+    }
+
+    ~writer () {
+      if (file != NULL) {
+        // Abandoned before close - leave the old index as it was
+        fclose(file);
+        remove(temp_path.c_str());
+      }
+    }
+
+    writer (const writer&) = delete;
+    writer& operator= (const writer&) = delete;
+
+    /**
+     *  Starts writing the index that close will store at path. Returns
+     *  false if the page size is not a power of two in [64, 1 MiB] or the
+     *  temporary file cannot be created.
+     */
+    bool open(const char* path, uint32_t page_size) {
+      if (!valid_page_size(page_size)) {
+        return false;
+      }
+
+      this->path = path;
+      temp_path = this->path + ".tmp";
+      file = fopen(temp_path.c_str(), "wb");
+      if (file == NULL) {
+        return false;
+      }
+
+      this->page_size = page_size;
+      next_page = 1;
+      num_keys = 0;
+      failed = false;
+      levels.clear();
+      add_level();
+
+      // Reserve page 0 for the header, written by close
+      vector<char> empty(page_size, 0);
+      failed = (fwrite(empty.data(), page_size, 1, file) != 1);
+      return !failed;
+    }
+
+    /**
+     *  Appends x. Returns false if x is smaller than the previous key;
+     *  the writer is then failed and close leaves the old index in place.
+     */
+    bool add(int x) {
+      if (num_keys > 0 and x <= last_key) {
+        if (x < last_key) {
+          failed = true;  // close will not replace the index
+        }
+        return x == last_key;
+      }
+
+      if (levels[0].entries == leaf_capacity(page_size)) {
+        flush(0);
+      }
+
+      level_buffer& leaf = levels[0];
+      if (leaf.entries == 0) {
+        leaf.min_key = x;
+      }
+      ((int*)(leaf.page.data() + PAGE_HEADER))[leaf.entries++] = x;
+
+      last_key = x;
+      num_keys++;
+      return true;
+    }
+
+    /**
+     *  Writes the pages still being filled and the header, then closes
+     *  the file and renames it over the index path. Returns false (and
+     *  leaves the old index in place) if any write failed.
+     */
+    bool close() {
+      if (file == NULL) {
+        return false;
+      }
+      if (failed) {
+        // A write failed or a key was out of order - keep the old index
+        fclose(file);
+        file = NULL;
+        remove(temp_path.c_str());
+        return false;
+      }
+
+      // Complete the levels bottom up; the first page that is alone on
+      // the top level is the root
+      disk_bplus_header header;
+      for (int level = 0; ; level++) {
+        if (level + 1 == (int)levels.size() and levels[level].pages_written == 0) {
+          header.root = write_page(level);
+          header.levels = level + 1;
+          break;
+        }
+        flush(level);
+      }
+
+      memset(&header.magic, 0, sizeof(header.magic));
+      memcpy(header.magic, "BPTREE", 6);
+      header.version = DISK_BPLUS_VERSION;
+      header.page_size = page_size;
+      header.num_keys = num_keys;
+      header.num_pages = next_page;
+
+      vector<char> first_page(page_size, 0);
+      memcpy(first_page.data(), &header, sizeof(header));
+      if (fseek(file, 0, SEEK_SET) != 0 or fwrite(first_page.data(), page_size, 1, file) != 1) {
+        failed = true;
+      }
+
+      // Make the pages durable before the new file replaces the old one
+      if (fflush(file) != 0 or fsync(fileno(file)) != 0) {
+        failed = true;
+      }
+      if (fclose(file) != 0) {
+        failed = true;
+      }
+      file = NULL;
+
+      if (failed or rename(temp_path.c_str(), path.c_str()) != 0) {
+        remove(temp_path.c_str());
+        return false;
+      }
+      return true;
+    }
+  };
+
+  disk_bplus_tree () {
+    base = NULL;
+    length = 0;
+  }
+
+  ~disk_bplus_tree () {
+    close();
+  }
+
+  disk_bplus_tree (const disk_bplus_tree&) = delete;
+  disk_bplus_tree& operator= (const disk_bplus_tree&) = delete;
+
+  /**
+   *  Writes the keys (sorted in non-decreasing order) to an index file
+   *  at path with the given page size. Returns false on failure, including
+   *  keys out of order, and then leaves any existing file at path untouched.
+   */
+  static bool build(const char* path, const int* sorted_keys, size_t n, uint32_t page_size = 4096) {
+    writer out;
+    if (!out.open(path, page_size)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (!out.add(sorted_keys[i])) {
+        return false;  // The writer removes its temporary file
+      }
+    }
+    return out.close();
+  }
+
+  /**
+   *  Maps the index file at path. Nothing is read except the header and
+   *  the root page, so this costs the same for any file size. Returns false
+   *  if the file is missing, truncated or not an index of this version.
+   *  Lookups check every page they visit, but trust the order of its keys.
+   */
+  bool open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 or (size_t)info.st_size < sizeof(disk_bplus_header)) {
+      ::close(fd);
+      return false;
+    }
+
+    length = info.st_size;
+    void* mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+      return false;
+    }
+    base = (const char*)mapping;
+    memcpy(&header, base, sizeof(header));
+
+    bool valid = memcmp(header.magic, "BPTREE\0\0", 8) == 0
+             and header.version == DISK_BPLUS_VERSION
+             and valid_page_size(header.page_size)
+             and header.num_pages * header.page_size == length
+             and header.levels > 0 and header.levels <= MAX_LEVELS
+             and valid_page(header.root, header.levels - 1);
+    if (!valid) {
+      close();
+      return false;
+    }
+
+    // Lookups touch pages in no useful order - do not read ahead
+    madvise((void*)base, length, MADV_RANDOM);
+    return true;
+  }
+
+  void close() {
+    if (base != NULL) {
+      munmap((void*)base, length);
+      base = NULL;
+    }
+  }
+
+  bool find(int x) const {
+    const char* current = page(header.root);
+
+    for (uint32_t level = header.levels - 1; level > 0; level--) {
+      uint32_t pos = count_less_equal(page_keys(current), page_count(current), x);
+      uint32_t child = page_children(current)[pos];
+      if (!valid_page(child, level - 1)) {
+        return false;  // Damaged file
+      }
+      current = page(child);
+    }
+
+    uint32_t count = page_count(current);
+    uint32_t pos = count_less_equal(page_keys(current), count, x);
+    return pos > 0 and page_keys(current)[pos - 1] == x;
+  }
+
+  void inorder() const {
+    inorder(header.root, header.levels - 1);
+  }
+
+  size_t size() const {
+    return header.num_keys;
+  }
+
+  size_t file_bytes() const {
+    return length;
+  }
+
+  int depth() const {
+    return header.levels;
+  }
+};
+
+
+/**
+ *  Open-addressing hash set for membership-only workloads
+ *  (Swiss table layout). Keys are stored once - repeated inserts are ignored.
+ *
+ *  Slots are grouped by 16. Next to every slot is a control byte: EMPTY,
+ *  or the low 7 bits of the hash of the key stored there. A lookup loads
+ *  the 16 control bytes of a group into one SSE2 register and compares
+ *  them with the 7-bit tag of x at once; only the slots whose tag matches
+ *  (on average far below one per group) compare the full key.
+ *  Groups are probed in triangular order, which visits every group of a
+ *  power-of-two table.
+ *
+ *  Operations:
+ *    - Insert complexity: O(1) expected, amortised over doubling.
+ *    - Find complexity: O(1) expected.
+ *    - inorder: O(n log n) - the keys are sorted first.
+ */
+class swiss_set {
+private:
+  static constexpr int GROUP = 16;
+  static constexpr int8_t EMPTY = -128; // 0b10000000, never a 7-bit tag
+
+  vector<int8_t> control;
+  vector<int> slots;
+  size_t group_mask;  // Number of groups - 1
+  size_t count;
+
+  static uint64_t hash(int x) {
+    // Murmur3 finaliser
+    uint64_t h = (uint32_t)x;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  /**
+   *  Bit i is set if control byte i of the group equals tag.
+   */
+  static unsigned match(const int8_t* group, int8_t tag) {
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag)));
+#else
+    unsigned result = 0;
+    for (int i = 0; i < GROUP; i++) {
+      result |= (unsigned)(group[i] == tag) << i;
+    }
+    return result;
+#endif
+  }
+
+  /**
+   *  Stores x, known to be absent, in the first empty slot of its probe sequence.
+   */
+  void place(int x, uint64_t h) {
+    size_t g = (h >> 7) & group_mask;
+
+    for (size_t step = 1; ; step++) {
+      unsigned empty = match(&control[g * GROUP], EMPTY);
+      if (empty != 0) {
+        size_t slot = g * GROUP + __builtin_ctz(empty);
+        control[slot] = h & 0x7f;
+        slots[slot] = x;
+        return;
+      }
+      g = (g + step) & group_mask;
+    }
+  }
+
+  /**
+   *  Doubles the number of groups and reinserts all keys.
+   */
+  void grow() {
+    vector<int8_t> old_control;
+    vector<int> old_slots;
+    old_control.swap(control);
+    old_slots.swap(slots);
+
+    size_t groups = 2 * (group_mask + 1);
+    control.assign(groups * GROUP, EMPTY);
+    slots.resize(groups * GROUP);
+    group_mask = groups - 1;
+
+    for (size_t i = 0; i < old_control.size(); i++) {
+      if (old_control[i] != EMPTY) {
+        place(old_slots[i], hash(old_slots[i]));
+      }
+    }
+  }
+
+public:
+  swiss_set () {
+    control.assign(GROUP, EMPTY);
+    slots.resize(GROUP);
+    group_mask = 0;
+    count = 0;
+  }
+
+  void insert(int x) {
+    if (find(x)) {
+      return;
+    }
+
+    // Keep the load factor at most 7/8
+    if (8 * (count + 1) > 7 * control.size()) {
+      grow();
+    }
+
+    place(x, hash(x));
+    count++;
+  }
+
+  bool find(int x) const {
+    uint64_t h = hash(x);
+    int8_t tag = h & 0x7f;
+    size_t g = (h >> 7) & group_mask;
+
+    for (size_t step = 1; ; step++) {
+      const int8_t* group = &control[g * GROUP];
+
+      for (unsigned candidates = match(group, tag); candidates != 0; candidates &= candidates - 1) {
+        if (slots[g * GROUP + __builtin_ctz(candidates)] == x) {
+          return true;
+        }
+      }
+
+      if (match(group, EMPTY) != 0) {
+        return false; // x would have been placed in this group
+      }
+      g = (g + step) & group_mask;
+    }
+  }
+
+  /**
+   *  Prints the keys in sorted order.
+   */
+  void inorder() const {
+    vector<int> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < control.size(); i++) {
+      if (control[i] != EMPTY) {
+        keys.push_back(slots[i]);
+      }
+    }
+
+    sort(keys.begin(), keys.end());
+    for (int i = 0; i < (int)keys.size(); i++) {
+      cout << keys[i] << endl;
+    }
+  }
+
+  int size() const {
+    return count;
+  }
+
+  size_t memory_bytes() const {
+    return control.size() * sizeof(int8_t) + slots.size() * sizeof(int);
+  }
+};
+
+
+/**
+ *  Concurrent binary search tree for read-mostly workloads, using
+ *  optimistic lock coupling.
+ *
+ *  Every node has a version word: the lowest bit is the write lock and
+ *  every unlock advances the version. Readers take no locks - they note
+ *  the version of a node, read its child, and check that the version did
+ *  not change before moving on (restarting from the top if it did).
+ *  Writers descend the same way and lock only the node whose child link
+ *  they fill in, by upgrading the noted version to locked with one CAS.
+ *  Keys never change once published, and links only go from NULL to a
+ *  fully built node (release/acquire), so readers never see partial nodes.
+ *
+ *  Nodes are never removed while the tree is alive, so no deferred
+ *  reclamation is needed. Insertion order decides the shape (unbalanced).
+ *
+ *  Operations:
+ *    - Insert complexity: O(depth), any number of concurrent writers.
+ *    - Find complexity: O(depth), lock-free for readers.
+ */
+class concurrent_bstree {
+private:
+  class cnode {
+  public:
+    const int value;
+    atomic<uint64_t> version;
+    atomic<cnode*> children[2]; // [0] - keys <= value, [1] - keys > value
+
+    cnode (int value) : value(value) {
+      version.store(0, memory_order_relaxed);
+      children[0].store(NULL, memory_order_relaxed);
+      children[1].store(NULL, memory_order_relaxed);
+    }
+  };
+
+  // Sentinel above the root: the whole tree is its children[0],
+  // so inserting the first key locks the sentinel like any other parent.
+  cnode head;
+
+  /**
+   *  Waits until x is not write-locked and returns its version.
+   */
+  static uint64_t read_lock(const cnode* x) {
+    uint64_t version = x->version.load(memory_order_acquire);
+    while (version & 1) {
+      this_thread::yield();
+      version = x->version.load(memory_order_acquire);
+    }
+    return version;
+  }
+
+  /**
+   *  Returns true if x was not modified since read_lock returned version.
+   */
+  static bool validate(const cnode* x, uint64_t version) {
+    atomic_thread_fence(memory_order_acquire);
+    return x->version.load(memory_order_relaxed) == version;
+  }
+
+  /**
+   *  Takes the write lock of x if it is still at version.
+   */
+  static bool upgrade_to_write_lock(cnode* x, uint64_t version) {
+    return x->version.compare_exchange_strong(version, version + 1, memory_order_acquire);
+  }
+
+  static void write_unlock(cnode* x) {
+    x->version.fetch_add(1, memory_order_release);  // Clears the lock bit, new version
+  }
+
+  int direction(const cnode* x, int key) const {
+    return (x == &head) ? 0 : (key > x->value);
+  }
+
+public:
+  concurrent_bstree () : head(INT_MAX) {
+  }
+
+  /**
+   *  Frees all nodes. Must not run concurrently with other operations.
+   */
+  ~concurrent_bstree () {
+    vector<cnode*> stack(1, head.children[0].load());
+    while (!stack.empty()) {
+      cnode* current = stack.back();
+      stack.pop_back();
+      if (current != NULL) {
+        stack.push_back(current->children[0].load());
+        stack.push_back(current->children[1].load());
+        delete current;
+      }
+    }
+  }
+
+  /**
+   *  Inserts x as a new leaf. Duplicates go to the left subtree.
+   */
+  void insert(int x) {
+    cnode* fresh = new cnode(x);
+
+  restart:
+    cnode* current = &head;
+    uint64_t version = read_lock(current);
+
+    while (true) {
+      int dir = direction(current, x);
+      cnode* next = current->children[dir].load(memory_order_acquire);
+      if (!validate(current, version)) {
+        goto restart;
+      }
+
+      if (next == NULL) {
+        if (!upgrade_to_write_lock(current, version)) {
+          goto restart; // Someone changed this node since we read it
+        }
+        current->children[dir].store(fresh, memory_order_release);
+        write_unlock(current);
+        return;
+      }
+
+      // Lock coupling: the child's version is taken before
+      // the parent's is checked once more
+      uint64_t next_version = read_lock(next);
+      if (!validate(current, version)) {
+        goto restart;
+      }
+
+      current = next;
+      version = next_version;
+    }
+  }
+
+  bool find(int x) const {
+  restart:
+    const cnode* current = &head;
+    uint64_t version = read_lock(current);
+
+    while (true) {
+      const cnode* next = current->children[direction(current, x)].load(memory_order_acquire);
+      if (!validate(current, version)) {
+        goto restart;
+      }
+      if (next == NULL) {
+        return false;
+      }
+
+      uint64_t next_version = read_lock(next);
+      if (next->value == x) {
+        return true;  // Keys are immutable - no validation needed
+      }
+
+      current = next;
+      version = next_version;
+    }
+  }
+
+  /**
+   *  Prints the keys in sorted order. Must not run concurrently with inserts.
+   */
+  void inorder() const {
+    vector<const cnode*> stack;
+    const cnode* current = head.children[0].load();
+
+    while (current != NULL or !stack.empty()) {
+      while (current != NULL) {
+        stack.push_back(current);
+        current = current->children[0].load();
+      }
+
+      current = stack.back();
+      stack.pop_back();
+      cout << current->value << endl;
+      current = current->children[1].load();
+    }
+  }
+};
+
+
+/**
+ *  Persistent (path-copying) AVL tree.
+ *  Nodes are never modified once they are shared: insert copies the
+ *  O(log n) nodes on the search path (rotations only touch those copies)
+ *  and links the copies to the untouched subtrees of the old version.
+ *  Every version therefore stays valid and unchanged, and taking a
+ *  snapshot is O(1) - it just shares the root.
+ *
+ *  Nodes are reference counted (atomically, so snapshots can be read and
+ *  dropped from other threads). A node is freed when no version can
+ *  reach it any more. A single handle must not be modified and
+ *  copied at the same time; copies of it are independent.
+ *
+ *  Operations:
+ *    - Insert complexity: O(log n) time and new nodes.
+ *    - Find complexity: O(log n).
+ *    - Snapshot complexity: O(1).
+ */
+class persistent_tree {
+private:
+  class pnode {
+  public:
+    int value;
+    int height;
+    atomic<int> refs;
+    pnode* left_child;  // Each child link owns one reference
+    pnode* right_child;
+
+    pnode (int value, pnode* left_child, pnode* right_child) {
+      this->value = value;
+      this->left_child = left_child;
+      this->right_child = right_child;
+      refs.store(1, memory_order_relaxed);
+      recalc(this);
+    }
+  };
+
+  pnode* root;  // Owns one reference
+
+  static int get_height(const pnode* x) {
+    return (x == NULL) ? 0 : x->height;
+  }
+
+  static void recalc(pnode* x) {
+    x->height = 1 + max(get_height(x->left_child), get_height(x->right_child));
+  }
+
+  static int balance_factor(const pnode* x) {
+    return get_height(x->left_child) - get_height(x->right_child);
+  }
+
+  static pnode* retain(pnode* x) {
+    if (x != NULL) {
+      x->refs.fetch_add(1, memory_order_relaxed);
+    }
+    return x;
+  }
+
+  /**
+   *  Drops one reference to x and frees every node that becomes unreachable.
+   */
+  static void release(pnode* x) {
+    vector<pnode*> stack(1, x);
+
+    while (!stack.empty()) {
+      pnode* current = stack.back();
+      stack.pop_back();
+
+      if (current != NULL and current->refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+        stack.push_back(current->left_child);
+        stack.push_back(current->right_child);
+        delete current;
+      }
+    }
+  }
+
+  /**
+   *  Rotations and rebalance take fresh (unshared) nodes only.
+   *  Ownership of the moved links is transferred, so no counts change.
+   */
+  static pnode* rotate_right(pnode* x) {
+    pnode* y = x->left_child;
+    x->left_child = y->right_child;
+    y->right_child = x;
+
+    recalc(x);
+    recalc(y);
+    return y;
+  }
+
+  static pnode* rotate_left(pnode* x) {
+    pnode* y = x->right_child;
+    x->right_child = y->left_child;
+    y->left_child = x;
+
+    recalc(x);
+    recalc(y);
+    return y;
+  }
+
+  /**
+   *  Restores the AVL property at the fresh node x. The heavier child and,
+   *  in the double rotation case, its inner child lie on the insertion path,
+   *  so they are fresh copies too.
+   */
+  static pnode* rebalance(pnode* x) {
+    int balance = balance_factor(x);
+
+    if (balance > 1) {
+      if (balance_factor(x->left_child) < 0) {
+        x->left_child = rotate_left(x->left_child);
+      }
+      return rotate_right(x);
+    }
+    if (balance < -1) {
+      if (balance_factor(x->right_child) > 0) {
+        x->right_child = rotate_right(x->right_child);
+      }
+      return rotate_left(x);
+    }
+
+    return x;
+  }
+
+  /**
+   *  Returns a new version of the subtree rooted at current with x inserted
+   *  (owning one reference). current itself is left untouched.
+   */
+  static pnode* insert(pnode* current, int x) {
+    if (current == NULL) {
+      return new pnode(x, NULL, NULL);
+    }
+
+    pnode* copy;
+    if (x <= current->value) {
+      copy = new pnode(current->value, insert(current->left_child, x), retain(current->right_child));
+    } else {
+      copy = new pnode(current->value, retain(current->left_child), insert(current->right_child, x));
+    }
+
+    return rebalance(copy);
+  }
+
+  static void inorder(const pnode* current) {
+    if (current == NULL) {
+      return;
+    }
+
+    inorder(current->left_child);
+    cout << current->value << endl;
+    inorder(current->right_child);
+  }
+
+public:
+  persistent_tree () {
+    root = NULL;
+  }
+
+  /**
+   *  Copying a handle is taking a snapshot - O(1).
+   */
+  persistent_tree (const persistent_tree& other) {
+    root = retain(other.root);
+  }
+
+  persistent_tree& operator=(const persistent_tree& other) {
+    pnode* old_root = root;
+    root = retain(other.root);
+    release(old_root);
+    return *this;
+  }
+
+  ~persistent_tree () {
+    release(root);
+  }
+
+  /**
+   *  Returns the current version. It does not see later inserts.
+   */
+  persistent_tree snapshot() const {
+    return *this;
+  }
+
+  /**
+   *  Makes this handle point to a new version that also contains x.
+   *  Snapshots taken before are unaffected.
+   */
+  void insert(int x) {
+    pnode* old_root = root;
+    root = insert(root, x);
+    release(old_root);
+  }
+
+  /**
+   *  Returns a new version that also contains x, leaving this one as it is.
+   */
+  persistent_tree with(int x) const {
+    persistent_tree result;
+    result.root = insert(root, x);
+    return result;
+  }
+
+  bool find(int x) const {
+    const pnode* current = root;
+
+    while (current != NULL and current->value != x) {
+      current = (x < current->value) ? current->left_child : current->right_child;
+    }
+
+    return current != NULL;
+  }
+
+  void inorder() const {
+    inorder(root);
+  }
+
+  int depth() const {
+    return get_height(root);
+  }
+};
+
+
+// ===========================  Benchmark  ===============================
+
+
+typedef chrono::steady_clock bench_clock;
+
+static double elapsed_ms(bench_clock::time_point start) {
+  return chrono::duration<double, milli>(bench_clock::now() - start).count();
+}
+
+static void print_result(const char* engine, int depth, double build_ms, double find_ms, int lookups, int hits) {
+  cout << "  " << engine << ": depth " << depth
+       << ", build " << build_ms << " ms"
+       << ", find " << find_ms * 1e6 / lookups << " ns/op"
+       << " (" << hits << " hits)" << endl;
+}
+
+template <class Tree>
+static void bench_tree(const char* engine, const vector<int>& keys, const vector<int>& lookups) {
+  bench_clock::time_point start = bench_clock::now();
+  Tree tree;
+  for (int i = 0; i < (int)keys.size(); i++) {
+    tree.insert(keys[i]);
+  }
+  double build_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += tree.find(lookups[i]);
+  }
+  double find_ms = elapsed_ms(start);
+
+  print_result(engine, tree.depth(), build_ms, find_ms, lookups.size(), hits);
+}
+
+static void bench_bulk(const vector<int>& keys, const vector<int>& lookups) {
+  bench_clock::time_point start = bench_clock::now();
+  bstree tree(keys.data(), keys.size());
+  double build_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += tree.find(lookups[i]);
+  }
+  double find_ms = elapsed_ms(start);
+
+  print_result("bulk", tree.depth(), build_ms, find_ms, lookups.size(), hits);
+}
+
+/**
+ *  Compares the memory use and lookup throughput of the bulk-loaded
+ *  tree and the hash set on the same keys.
+ */
+static void bench_hash(const vector<int>& keys, const vector<int>& lookups) {
+  bstree tree(keys.data(), keys.size());
+
+  bench_clock::time_point start = bench_clock::now();
+  swiss_set set;
+  for (int i = 0; i < (int)keys.size(); i++) {
+    set.insert(keys[i]);
+  }
+  double build_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int tree_hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    tree_hits += tree.find(lookups[i]);
+  }
+  double tree_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += set.find(lookups[i]);
+  }
+  double find_ms = elapsed_ms(start);
+
+  cout << "  tree: " << (double)tree.memory_bytes() / keys.size() << " bytes/key, "
+       << lookups.size() / tree_ms / 1e3 << " M lookups/s (" << tree_hits << " hits)" << endl;
+  cout << "  hash: " << (double)set.memory_bytes() / keys.size() << " bytes/key, "
+       << lookups.size() / find_ms / 1e3 << " M lookups/s (" << hits << " hits), build "
+       << build_ms << " ms" << endl;
+}
+
+/**
+ *  Runs the same lookups through bstree::find_batch on a tree built by
+ *  inserting the keys in random order, next to the scalar loop.
+ */
+static void bench_batch(const vector<int>& keys, const vector<int>& lookups) {
+  vector<int> shuffled(keys);
+  shuffle(shuffled.begin(), shuffled.end(), mt19937(777));
+
+  bstree tree;
+  for (int i = 0; i < (int)shuffled.size(); i++) {
+    tree.insert(shuffled[i]);
+  }
+
+  bench_clock::time_point start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += tree.find(lookups[i]);
+  }
+  print_result("scalar", tree.depth(), 0, elapsed_ms(start), lookups.size(), hits);
+
+  bool* found = new bool[lookups.size()];
+  start = bench_clock::now();
+  tree.find_batch(lookups.data(), lookups.size(), found);
+  double find_ms = elapsed_ms(start);
+
+  hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += found[i];
+  }
+  print_result("batch", tree.depth(), 0, find_ms, lookups.size(), hits);
+
+  // Coroutine-interleaved lookups, sweeping the number in flight
+  int widths[] = {1, 2, 4, 8, 12, 16, 24, 32};
+  for (int w = 0; w < 8; w++) {
+    start = bench_clock::now();
+    tree.find_interleaved(lookups.data(), lookups.size(), found, widths[w]);
+    find_ms = elapsed_ms(start);
+
+    hits = 0;
+    for (int i = 0; i < (int)lookups.size(); i++) {
+      hits += found[i];
+    }
+
+    string engine = "coroutines, width " + to_string(widths[w]);
+    print_result(engine.c_str(), tree.depth(), 0, find_ms, lookups.size(), hits);
+  }
+
+  delete[] found;
+}
+
+/**
+ *  Inserts a feed dominated by repeated keys into a plain and a
+ *  multiset tree and compares their size, depth and speed.
+ */
+static void bench_multiset(const vector<int>& feed, const vector<int>& lookups) {
+  for (int mode = 0; mode < 2; mode++) {
+    bench_clock::time_point start = bench_clock::now();
+    bstree tree(mode == 1);
+    for (int i = 0; i < (int)feed.size(); i++) {
+      tree.insert(feed[i]);
+    }
+    double build_ms = elapsed_ms(start);
+
+    start = bench_clock::now();
+    int hits = 0;
+    for (int i = 0; i < (int)lookups.size(); i++) {
+      hits += tree.find(lookups[i]);
+    }
+    double find_ms = elapsed_ms(start);
+
+    print_result((mode == 1) ? "multiset" : "plain", tree.depth(), build_ms, find_ms, lookups.size(), hits);
+    cout << "    " << tree.nodes() << " nodes, " << tree.nodes() * sizeof(node) << " bytes" << endl;
+  }
+}
+
+/**
+ *  Compares lookups per second and index bytes per key on timestamp-like
+ *  keys (random gaps of 1 to 100): bulk-loaded tree, binary search over
+ *  the sorted array, Eytzinger index and learned index.
+ */
+static void bench_learned(int n, int num_lookups, mt19937& rng) {
+  // Gaps of up to 100, narrowed for large n so the last key stays <= INT_MAX
+  int max_gap = max(1, min(100, INT_MAX / max(n, 1)));
+  vector<int> keys(n);
+  int stamp = 0;
+  for (int i = 0; i < n; i++) {
+    stamp += uniform_int_distribution<int>(1, max_gap)(rng);
+    keys[i] = stamp;
+  }
+
+  vector<int> lookups(num_lookups);
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    lookups[i] = (i % 2 == 0) ? keys[rng() % n] : uniform_int_distribution<int>(0, stamp)(rng);
+  }
+
+  bstree tree(keys.data(), n);
+  eytzinger_index eytzinger = tree.freeze();
+  bench_clock::time_point start = bench_clock::now();
+  learned_index learned = tree.freeze_learned();
+  double build_ms = elapsed_ms(start);
+
+  // Every engine stores the keys once; count only what it adds on top
+  // (for the tree, the two child links of every node)
+  const char* names[] = {"tree", "binary search", "eytzinger", "learned"};
+  size_t bytes[] = {tree.memory_bytes() - tree.nodes() * sizeof(int), 0, 0, learned.index_bytes()};
+  int mismatches = 0;
+
+  for (int engine = 0; engine < 4; engine++) {
+    start = bench_clock::now();
+    int hits = 0;
+    for (int i = 0; i < (int)lookups.size(); i++) {
+      bool found;
+      if (engine == 0) {
+        found = tree.find(lookups[i]);
+      } else if (engine == 1) {
+        found = binary_search(keys.begin(), keys.end(), lookups[i]);
+      } else if (engine == 2) {
+        found = eytzinger.find(lookups[i]);
+      } else {
+        found = learned.find(lookups[i]);
+      }
+      hits += found;
+    }
+    double find_ms = elapsed_ms(start);
+
+    cout << "  " << names[engine] << ": " << lookups.size() / find_ms / 1e3 << " M lookups/s, "
+         << (double)bytes[engine] / n << " index bytes/key beyond the keys (" << hits << " hits)" << endl;
+  }
+
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    mismatches += (learned.find(lookups[i]) != tree.find(lookups[i]));
+  }
+
+  cout << "  learned: " << learned.num_segments() << " segments, built in " << build_ms << " ms";
+  if (mismatches > 0) {
+    cout << ", " << mismatches << " results differ from bstree::find";
+  }
+  cout << endl;
+}
+
+/**
+ *  Freezes a bulk-loaded tree and checks that the index answers
+ *  every lookup exactly like bstree::find.
+ */
+static void bench_frozen(const vector<int>& keys, const vector<int>& lookups) {
+  bstree tree(keys.data(), keys.size());
+
+  bench_clock::time_point start = bench_clock::now();
+  eytzinger_index index = tree.freeze();
+  double build_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    hits += index.find(lookups[i]);
+  }
+  double find_ms = elapsed_ms(start);
+
+  print_result("frozen", index.depth(), build_ms, find_ms, lookups.size(), hits);
+
+  int mismatches = 0;
+  for (int i = 0; i < (int)lookups.size(); i++) {
+    mismatches += (index.find(lookups[i]) != tree.find(lookups[i]));
+  }
+  if (mismatches > 0) {
+    cout << "  frozen: " << mismatches << " results differ from bstree::find" << endl;
+  }
+}
+
+/**
+ *  Multithreaded benchmark of concurrent_bstree. The tree is preloaded with
+ *  the keys; then every thread performs ops_per_thread operations, each an
+ *  insert of a new key with probability write_ratio and a lookup otherwise.
+ *  Sweeps the thread count and the write ratio and reports total throughput.
+ */
+static void run_concurrent_benchmark(int n, int ops_per_thread) {
+  mt19937 rng(12345);
+  vector<int> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = 2 * i;
+  }
+  shuffle(keys.begin(), keys.end(), rng);
+
+  double write_ratios[] = {0, 0.01, 0.1, 0.5};
+  int thread_counts[] = {1, 2, 4, 8, 16, 32};
+
+  for (int w = 0; w < 4; w++) {
+    cout << "write ratio " << write_ratios[w] << ", n = " << n << endl;
+
+    for (int t = 0; t < 6; t++) {
+      concurrent_bstree tree;
+      for (int i = 0; i < n; i++) {
+        tree.insert(keys[i]);
+      }
+
+      atomic<int> hits(0);
+      vector<thread> threads;
+      bench_clock::time_point start = bench_clock::now();
+
+      for (int id = 0; id < thread_counts[t]; id++) {
+        threads.push_back(thread([&tree, &hits, n, id, ops_per_thread, ratio = write_ratios[w]]() {
+          mt19937 local_rng(id);
+          uniform_real_distribution<double> coin(0, 1);
+          int local_hits = 0;
+
+          for (int i = 0; i < ops_per_thread; i++) {
+            int key = uniform_int_distribution<int>(0, 2 * n - 1)(local_rng);
+            if (coin(local_rng) < ratio) {
+              tree.insert(key | 1);  // Odd keys are new
+            } else {
+              local_hits += tree.find(key);
+            }
+          }
+          hits += local_hits;
+        }));
+      }
+
+      for (int id = 0; id < (int)threads.size(); id++) {
+        threads[id].join();
+      }
+      double total_ms = elapsed_ms(start);
+
+      cout << "  " << thread_counts[t] << " threads: "
+           << (double)thread_counts[t] * ops_per_thread / total_ms / 1e3 << " M ops/s ("
+           << hits << " hits)" << endl;
+    }
+  }
+}
+
+/**
+ *  Returns count lookups following a Zipf(skew) distribution over keys:
+ *  the key of rank r (in a random order) is requested with probability
+ *  proportional to 1 / r^skew.
+ */
+static vector<int> zipf_lookups(const vector<int>& keys, int count, double skew, mt19937& rng) {
+  int n = keys.size();
+  vector<double> cdf(n);
+  double total = 0;
+  for (int r = 0; r < n; r++) {
+    total += 1.0 / pow(r + 1, skew);
+    cdf[r] = total;
+  }
+
+  vector<int> by_rank(keys);
+  shuffle(by_rank.begin(), by_rank.end(), rng);
+
+  vector<int> result(count);
+  uniform_real_distribution<double> uniform(0, total);
+  for (int i = 0; i < count; i++) {
+    int r = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    result[i] = by_rank[min(r, n - 1)];
+  }
+
+  return result;
+}
+
+/**
+ *  Times union, intersection and difference of two AVL trees with n
+ *  distinct random keys each (about half of them shared) on 1 to 32
+ *  threads, next to inserting one tree's keys into the other.
+ */
+static void run_set_benchmark(int n) {
+  mt19937 rng(12345);
+  vector<int> universe(2 * n);
+  for (int i = 0; i < 2 * n; i++) {
+    universe[i] = i;
+  }
+
+  shuffle(universe.begin(), universe.end(), rng);
+  vector<int> first(universe.begin(), universe.begin() + n);
+  shuffle(universe.begin(), universe.end(), rng);
+  vector<int> second(universe.begin(), universe.begin() + n);
+
+  cout << "set operations, n = " << n << " + " << n << endl;
+  {
+    avl_tree a;
+    for (int i = 0; i < n; i++) {
+      a.insert(first[i]);
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < n; i++) {
+      if (!a.find(second[i])) {
+        a.insert(second[i]);
+      }
+    }
+    cout << "  reinsertion union: " << elapsed_ms(start) << " ms (" << a.size() << " keys)" << endl;
+  }
+
+  const char* names[] = {"union", "intersection", "difference"};
+  int thread_counts[] = {1, 2, 4, 8, 16, 32};
+
+  for (int op = 0; op < 3; op++) {
+    for (int t = 0; t < 6; t++) {
+      avl_tree a, b;
+      for (int i = 0; i < n; i++) {
+        a.insert(first[i]);
+        b.insert(second[i]);
+      }
+
+      bench_clock::time_point start = bench_clock::now();
+      if (op == 0) {
+        a.unite(b, thread_counts[t]);
+      } else if (op == 1) {
+        a.intersect(b, thread_counts[t]);
+      } else {
+        a.subtract(b, thread_counts[t]);
+      }
+      double total_ms = elapsed_ms(start);
+
+      cout << "  " << names[op] << ", " << thread_counts[t] << " threads: "
+           << total_ms << " ms (" << a.size() << " keys)" << endl;
+    }
+  }
+}
+
+/**
+ *  Times the phases of the bulk load of n random keys on 1 to 32 threads.
+ */
+static void run_load_benchmark(int n) {
+  mt19937 rng(12345);
+  vector<int> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = rng();
+  }
+
+  cout << "parallel bulk load, n = " << n << endl;
+  int thread_counts[] = {1, 2, 4, 8, 16, 32};
+
+  for (int t = 0; t < 6; t++) {
+    bstree::load_timings timings;
+    bstree tree(keys.data(), n, false, thread_counts[t], &timings);
+
+    cout << "  " << thread_counts[t] << " threads: sort " << timings.sort_ms
+         << " ms, build " << timings.build_ms << " ms (depth " << tree.depth() << ")" << endl;
+  }
+}
+
+/**
+ *  Writes n random keys to a disk B+-tree for several page sizes and
+ *  reports the build time, the time to open the file and the lookup latency.
+ *  The file is created in the working directory and removed afterwards.
+ */
+static void run_disk_benchmark(int n) {
+  const char* path = "bstree-bench.bpt";
+  const int num_lookups = 1000000;
+  mt19937 rng(12345);
+
+  vector<int> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = rng();
+  }
+  vector<int> lookups(num_lookups);
+  for (int i = 0; i < num_lookups; i++) {
+    lookups[i] = (i % 2 == 0) ? keys[rng() % n] : (int)rng();
+  }
+  sort(keys.begin(), keys.end());
+
+  cout << "disk B+-tree, n = " << n << endl;
+  uint32_t page_sizes[] = {512, 4096, 16384, 65536};
+
+  for (int p = 0; p < 4; p++) {
+    bench_clock::time_point start = bench_clock::now();
+    if (!disk_bplus_tree::build(path, keys.data(), n, page_sizes[p])) {
+      cout << "  cannot write " << path << endl;
+      return;
+    }
+    double build_ms = elapsed_ms(start);
+
+    start = bench_clock::now();
+    disk_bplus_tree tree;
+    tree.open(path);
+    double open_ms = elapsed_ms(start);
+
+    start = bench_clock::now();
+    int hits = 0;
+    for (int i = 0; i < num_lookups; i++) {
+      hits += tree.find(lookups[i]);
+    }
+    double find_ms = elapsed_ms(start);
+
+    cout << "  page " << page_sizes[p] << " B: " << tree.file_bytes() / (1 << 20) << " MiB, depth " << tree.depth()
+         << ", build " << build_ms << " ms, open " << open_ms << " ms, "
+         << find_ms * 1e6 / num_lookups << " ns/find (" << hits << " hits)" << endl;
+  }
+
+  remove(path);
+}
+
+static const int PLAIN_SKEWED_LIMIT = 20000;
+
+/**
+ *  Compares the depth and lookup latency of the engines on sorted,
+ *  reverse-sorted and random inputs of n keys (even numbers 0, 2, ..., 2n - 2).
+ *  Half of the lookups are hits and half are misses.
+ */
+static void run_benchmark(int n) {
+  mt19937 rng(12345);
+
+  vector<int> sorted_keys(n);
+  for (int i = 0; i < n; i++) {
+    sorted_keys[i] = 2 * i;
+  }
+
+  vector<int> lookups(n);
+  for (int i = 0; i < n; i++) {
+    lookups[i] = uniform_int_distribution<int>(0, 2 * n - 1)(rng);
+  }
+
+  vector<int> reverse_keys(sorted_keys.rbegin(), sorted_keys.rend());
+  vector<int> random_keys(sorted_keys);
+  shuffle(random_keys.begin(), random_keys.end(), rng);
+
+  const char* names[] = {"sorted", "reverse-sorted", "random"};
+  const vector<int>* inputs[] = {&sorted_keys, &reverse_keys, &random_keys};
+
+  for (int i = 0; i < 3; i++) {
+    cout << names[i] << " input, n = " << n << endl;
+    if (i == 2 or n <= PLAIN_SKEWED_LIMIT) {
+      bench_tree<bstree>("plain", *inputs[i], lookups);
+    } else {
+      cout << "  plain: skipped (quadratic build on skewed input)" << endl;
+    }
+    bench_tree<avl_tree>("avl", *inputs[i], lookups);
+    bench_bulk(*inputs[i], lookups);
+    bench_frozen(*inputs[i], lookups);
+    bench_tree<bplus_tree>("bplus", *inputs[i], lookups);
+    bench_tree<persistent_tree>("persistent", *inputs[i], lookups);
+  }
+
+  cout << "Zipf(0.99) lookups, random insertion order, n = " << n << endl;
+  vector<int> zipf = zipf_lookups(random_keys, n, 0.99, rng);
+  bench_tree<bstree>("plain", random_keys, zipf);
+  bench_tree<avl_tree>("avl", random_keys, zipf);
+  bench_tree<splay_tree>("splay", random_keys, zipf);
+
+  cout << "bulk-loaded tree vs hash set, n = " << n << endl;
+  bench_hash(random_keys, lookups);
+
+  cout << "read-only indexes on timestamp-like keys, n = " << n << endl;
+  bench_learned(n, n, rng);
+
+  if (n <= PLAIN_SKEWED_LIMIT) {
+    // n / 100 distinct keys, each repeated about 100 times
+    vector<int> feed(n);
+    for (int i = 0; i < n; i++) {
+      feed[i] = 2 * uniform_int_distribution<int>(0, n / 100)(rng);
+    }
+
+    cout << "repeated keys (" << n / 100 + 1 << " distinct), n = " << n << endl;
+    bench_multiset(feed, lookups);
+  } else {
+    cout << "repeated keys: skipped (quadratic build of the plain tree)" << endl;
+  }
+
+  cout << "scalar find vs find_batch vs coroutines, random insertion order" << endl;
+  bench_batch(sorted_keys, lookups);
+}
+
+
+/**
+ *  Reads the queries from stdin and prints 1 for every key
+ *  present in the tree and 0 otherwise.
+ */
+template <class Tree>
+static void answer_queries(Tree& tree) {
+  int q;
+  int e;
+  cin >> q;
+
+  for (int i = 0; i < q; i++) {
+    cin >> e;
+    cout << tree.find(e) << endl;
+  }
+}
+
+
+/**
+ *  Reads typed queries from stdin for the order-statistic operations:
+ *    1 x      - prints 1 if x is in the tree, 0 otherwise
+ *    2 x      - erases one occurrence of x, prints 1 if it was present
+ *    3 x      - prints the number of keys smaller than x
+ *    4 k      - prints the k-th smallest key (0-based), "none" if out of range
+ *    5 lo hi  - prints the number of keys in [lo, hi]
+ */
+static void answer_order_queries(avl_tree& tree) {
+  int q;
+  int type, x, y;
+  cin >> q;
+
+  for (int i = 0; i < q; i++) {
+    cin >> type >> x;
+
+    if (type == 1) {
+      cout << tree.find(x) << endl;
+    } else if (type == 2) {
+      cout << tree.erase(x) << endl;
+    } else if (type == 3) {
+      cout << tree.rank(x) << endl;
+    } else if (type == 4) {
+      int result;
+      if (tree.select(x, result)) {
+        cout << result << endl;
+      } else {
+        cout << "none" << endl;
+      }
+    } else if (type == 5) {
+      cin >> y;
+      cout << tree.count_range(x, y) << endl;
+    } else {
+      cout << "Invalid query type." << endl;
+    }
+  }
+}
+
+
+/**
+ *  Reads typed queries from stdin for the multiset operations:
+ *    1 x  - prints the number of occurrences of x
+ *    2 x  - erases one occurrence of x, prints 1 if it was present
+ */
+static void answer_count_queries(bstree& tree) {
+  int q;
+  int type, x;
+  cin >> q;
+
+  for (int i = 0; i < q; i++) {
+    cin >> type >> x;
+
+    if (type == 1) {
+      cout << tree.count(x) << endl;
+    } else if (type == 2) {
+      cout << tree.erase(x) << endl;
+    } else {
+      cout << "Invalid query type." << endl;
+    }
+  }
+}
+
+
+/**
+ *  Reads typed navigation queries from stdin:
+ *    1 x      - prints the smallest key >= x
+ *    2 x      - prints the smallest key > x (successor)
+ *    3 x      - prints the largest key < x (predecessor)
+ *    4 lo hi  - prints the keys in [lo, hi] on one line
+ *  "none" is printed when there is no such key.
+ */
+static void answer_navigation_queries(const bstree& tree) {
+  int q;
+  int type, x, y, result;
+  cin >> q;
+
+  for (int i = 0; i < q; i++) {
+    cin >> type >> x;
+
+    if (type == 1 or type == 2 or type == 3) {
+      bool found = (type == 1) ? tree.lower_bound(x, result)
+                 : (type == 2) ? tree.successor(x, result)
+                 : tree.predecessor(x, result);
+      if (found) {
+        cout << result << endl;
+      } else {
+        cout << "none" << endl;
+      }
+    } else if (type == 4) {
+      cin >> y;
+
+      bool empty = true;
+      for (bstree::range_iterator it = tree.range(x, y); it.valid(); it.next()) {
+        cout << it.value() << " ";
+        empty = false;
+      }
+      cout << (empty ? "none" : "") << endl;
+    } else {
+      cout << "Invalid query type." << endl;
+    }
+  }
+}
+
+
+/**
+ *  Same as answer_queries, but reads all queries first and answers them
+ *  with one find_batch call, or with coroutine lookups if width > 0.
+ */
+static void answer_queries_batch(const bstree& tree, int width) {
+  int q;
+  cin >> q;
+
+  vector<int> queries(q);
+  for (int i = 0; i < q; i++) {
+    cin >> queries[i];
+  }
+
+  bool* found = new bool[q];
+  if (width > 0) {
+    tree.find_interleaved(queries.data(), q, found, width);
+  } else {
+    tree.find_batch(queries.data(), q, found);
+  }
+  for (int i = 0; i < q; i++) {
+    cout << found[i] << endl;
+  }
+  delete[] found;
+}
+
+
+/**
+ *  Driver program.
+ *  Usage:
+ *    bstree [engine]     - reads the keys and the membership queries from stdin;
+ *                          engine: plain (default), avl, bulk, frozen, bplus, batch, hash,
+ *                          concurrent, persistent, splay, learned
+ *    bstree coro [width] - same, with width >= 1 coroutine lookups in flight (default 16)
+ *    bstree disk file [page_size]
+ *                        - writes the keys to a disk B+-tree at file (pages of page_size
+ *                          bytes, default 4096), then answers the queries from the file
+ *    bstree disk-open file
+ *                        - answers the queries (q, then q keys on stdin) from an
+ *                          existing disk B+-tree file, without rebuilding it
+ *    bstree stats        - AVL tree with typed order-statistic queries (see answer_order_queries)
+ *    bstree multiset     - multiset tree with typed count/erase queries (see answer_count_queries)
+ *    bstree navigate     - typed ordered-navigation queries (see answer_navigation_queries)
+ *    bstree bench [n]    - runs the benchmark on n keys (default 10000)
+ *    bstree bench-disk [n]
+ *                        - disk B+-tree on n keys for several page sizes (default 10000000)
+ *    bstree bench-load [n]
+ *                        - phases of the parallel bulk load of n keys (default 10000000)
+ *    bstree bench-sets [n]
+ *                        - parallel set operations on two AVL trees of n keys (default 1000000)
+ *    bstree bench-concurrent [n] [ops]
+ *                        - multithreaded benchmark of concurrent_bstree on n keys
+ *                          (default 1000000), ops operations per thread (default 1000000)
+ */
+int main(int argc, char** argv) {
+  string mode = (argc > 1) ? argv[1] : "plain";
+  int width = (argc > 2) ? atoi(argv[2]) : 16;
+
+  if (mode == "coro" and width < 1) {
+    cerr << "the coroutine width must be at least 1" << endl;
+    return 1;
+  }
+
+  if (mode == "bench") {
+    run_benchmark((argc > 2) ? atoi(argv[2]) : 10000);
+    return 0;
+  }
+  if (mode == "bench-disk") {
+    run_disk_benchmark((argc > 2) ? atoi(argv[2]) : 10000000);
+    return 0;
+  }
+  if (mode == "disk-open") {
+    disk_bplus_tree tree;
+    if (argc < 3 or !tree.open(argv[2])) {
+      cerr << "cannot open the index file" << endl;
+      return 1;
+    }
+    answer_queries(tree);
+    return 0;
+  }
+  if (mode == "bench-load") {
+    run_load_benchmark((argc > 2) ? atoi(argv[2]) : 10000000);
+    return 0;
+  }
+  if (mode == "bench-sets") {
+    run_set_benchmark((argc > 2) ? atoi(argv[2]) : 1000000);
+    return 0;
+  }
+  if (mode == "bench-concurrent") {
+    run_concurrent_benchmark((argc > 2) ? atoi(argv[2]) : 1000000, (argc > 3) ? atoi(argv[3]) : 1000000);
+    return 0;
+  }
+
+  int n;
+  cin >> n;
+
+  vector<int> a(n);
+  for (int i = 0; i < n; i++) {
+    cin >> a[i];
+  }
+
+  if (mode == "avl") {
+    avl_tree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries(tree);
+
+  } else if (mode == "stats") {
+    avl_tree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_order_queries(tree);
+
+  } else if (mode == "multiset") {
+    bstree tree(true);
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_count_queries(tree);
+
+  } else if (mode == "navigate") {
+    bstree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_navigation_queries(tree);
+
+  } else if (mode == "bulk") {
+    bstree tree(a.data(), n);
+    answer_queries(tree);
+
+  } else if (mode == "disk") {
+    vector<int> sorted_keys = a;
+    sort(sorted_keys.begin(), sorted_keys.end());
+
+    disk_bplus_tree tree;
+    const char* path = (argc > 2) ? argv[2] : "bstree.bpt";
+    uint32_t page_size = (argc > 3) ? atoi(argv[3]) : 4096;
+    if (!disk_bplus_tree::build(path, sorted_keys.data(), n, page_size) or !tree.open(path)) {
+      cerr << "cannot write the index file" << endl;
+      return 1;
+    }
+    answer_queries(tree);
+
+  } else if (mode == "bplus") {
+    bplus_tree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries(tree);
+
+  } else if (mode == "batch") {
+    bstree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries_batch(tree, 0);
+
+  } else if (mode == "coro") {
+    bstree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries_batch(tree, width);
+
+  } else if (mode == "hash") {
+    swiss_set set;
+    for (int i = 0; i < n; i++) {
+      set.insert(a[i]);
+    }
+    answer_queries(set);
+
+  } else if (mode == "concurrent") {
+    concurrent_bstree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries(tree);
+
+  } else if (mode == "persistent") {
+    persistent_tree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries(tree);
+
+  } else if (mode == "splay") {
+    splay_tree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+    answer_queries(tree);
+
+  } else if (mode == "learned") {
+    bstree tree(a.data(), n);
+    learned_index index = tree.freeze_learned();
+    tree.clear();
+    answer_queries(index);
+
+  } else if (mode == "frozen") {
+    bstree tree(a.data(), n);
+    eytzinger_index index = tree.freeze();
+    tree.clear();
+    answer_queries(index);
+
+  } else {
+    bstree tree;
+    for (int i = 0; i < n; i++) {
+      tree.insert(a[i]);
+    }
+
+    // tree.inorder();
+    answer_queries(tree);
+  }
 
   return 0;
-}
\ No newline at end of file
+}
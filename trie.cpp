@@ -6,21 +6,180 @@
  *      - a word can contain only alphabetic characters and
  *        '.' - which means any character can match this position.
  *
+ *  ArtTrie (adaptive radix tree) accepts words made of any bytes.
+ *
+ *  Lookups can also run as C++20 coroutines, several of them
+ *  interleaved to hide memory latency.
+ *  Compile with: g++ -std=c++20 -O2 trie.cpp
+ *  The LOUDS file format is read through mmap and needs a POSIX system.
+ *
  *  Jovan Petreski - 06/04/2021
  */
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <coroutine>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define endl '\n'
 #define ALPHABET_SIZE 26
 using namespace std;
 
+/**
+ *  Coroutine returning the answer of one lookup.
+ *  A lookup suspends right after it prefetches the next node;
+ *  run_interleaved resumes the other lookups meanwhile.
+ */
+class lookup_task {
+public:
+  class promise_type {
+  public:
+    bool result = false;
+
+    lookup_task get_return_object() {
+      return lookup_task(coroutine_handle<promise_type>::from_promise(*this));
+    }
+    suspend_always initial_suspend() noexcept { return {}; }
+    suspend_always final_suspend() noexcept { return {}; }
+    void return_value(bool value) { result = value; }
+    void unhandled_exception() { terminate(); }
+  };
+
+  coroutine_handle<promise_type> handle;
+
+  explicit lookup_task (coroutine_handle<promise_type> handle = nullptr) {
+    this->handle = handle;
+  }
+};
+
+/**
+ *  Runs the lookups make_task(0), ..., make_task(n - 1) keeping up to
+ *  width of them in flight and resuming them round-robin.
+ *  A width below 1 runs them one at a time.
+ *  Writes the result of lookup i to out[i].
+ */
+template <class MakeTask>
+void run_interleaved(size_t n, int width, MakeTask make_task, vector<bool>& out) {
+  width = max(width, 1);
+  vector<lookup_task> slots(width);
+  vector<size_t> query(width);
+  size_t next = 0;
+  int in_flight = 0;
+
+  for (int i = 0; i < width and next < n; i++, next++) {
+    slots[i] = make_task(next);
+    query[i] = next;
+    in_flight++;
+  }
+
+  while (in_flight > 0) {
+    for (int i = 0; i < width; i++) {
+      if (!slots[i].handle) {
+        continue;
+      }
+
+      slots[i].handle.resume();
+      if (!slots[i].handle.done()) {
+        continue;
+      }
+
+      // Finished - collect the result and refill the slot
+      out[query[i]] = slots[i].handle.promise().result;
+      slots[i].handle.destroy();
+      slots[i].handle = nullptr;
+      in_flight--;
+
+      if (next < n) {
+        slots[i] = make_task(next);
+        query[i] = next++;
+        in_flight++;
+      }
+    }
+  }
+}
+
+
+/**
+ *  A node keeps its children packed: child_bits has bit c set if there
+ *  is a child for the letter 'a' + c, and children holds only those
+ *  children, in letter order. The child for letter c is at index
+ *  popcount(child_bits & ((1 << c) - 1)) - the number of present
+ *  letters before c. A leaf allocates no child array at all.
+ */
 class TrieNode {
 private:
   char key;                   // The letter this node holds
-  vector<TrieNode*> children; // Indexed from 0 to ALPHABET_SIZE - 1
   bool word_end;              // true if a word ends at this node
+  uint16_t length_mask;       // Bit k set if a word ends k letters below (15: 15 or more)
+  uint32_t child_bits;        // Bit c set if there is a child for letter c
+  TrieNode** children;        // popcount(child_bits) children in letter order
+
+  friend class DoubleArrayTrie;
+  friend class LoudsTrie;
+
+  int num_children() const {
+    return __builtin_popcount(child_bits);
+  }
+
+  static constexpr int MAX_LENGTH_BIT = 15;
+
+  /**
+   *  Returns false if no word ends exactly remaining letters below this node.
+   *  Distances of 15 and more share one bit, so those are never ruled out.
+   */
+  bool reaches(int remaining) const {
+    return (length_mask >> min(remaining, MAX_LENGTH_BIT)) & 1;
+  }
+
+  /**
+   *  Returns the child for the letter c (0-based), nullptr if there is none.
+   */
+  TrieNode* child(int c) const {
+    uint32_t bit = 1u << c;
+    if (!(child_bits & bit)) {
+      return nullptr;
+    }
+    return children[__builtin_popcount(child_bits & (bit - 1))];
+  }
+
+  /**
+   *  Creates the child for the letter c, which must not exist yet.
+   *  The packed array grows by one slot, so adding a node is O(ALPHABET_SIZE).
+   */
+  TrieNode* add_child(int c) {
+    int count = num_children();
+    int pos = __builtin_popcount(child_bits & ((1u << c) - 1));
+
+    TrieNode** grown = new TrieNode*[count + 1];
+    for (int i = 0; i < pos; i++) {
+      grown[i] = children[i];
+    }
+    grown[pos] = new TrieNode('a' + c);
+    for (int i = pos; i < count; i++) {
+      grown[i + 1] = children[i];
+    }
+
+    delete[] children;
+    children = grown;
+    child_bits |= 1u << c;
+    return grown[pos];
+  }
 
 public:
   /**
@@ -28,8 +187,11 @@ public:
    *  of the root node (no key value needed).
    */
   TrieNode() {
+    key = 0;
     word_end = false;
-    children.resize(ALPHABET_SIZE);
+    child_bits = 0;
+    length_mask = 0;
+    children = nullptr;
   }
 
   /**
@@ -39,23 +201,43 @@ public:
   TrieNode(char key) {
     this->key = key;
     word_end = false;
-    children.resize(ALPHABET_SIZE);
+    child_bits = 0;
+    length_mask = 0;
+    children = nullptr;
+  }
+
+  /**
+   *  Frees the whole subtree.
+   */
+  ~TrieNode() {
+    for (int i = 0; i < num_children(); i++) {
+      delete children[i];
+    }
+    delete[] children;
   }
 
+  TrieNode(const TrieNode&) = delete;
+  TrieNode& operator=(const TrieNode&) = delete;
+
   /**
    *  Adds a word to the data structure.
    */
   void add(string word) {
     TrieNode* curr_node = this;
+    int length = word.length();
 
-    for (int i = 0; i < (int)word.length(); i++) {
-      if (curr_node->children[word[i] - 'a'] == nullptr) {
-        curr_node->children[word[i] - 'a'] = new TrieNode(word[i]);
+    for (int i = 0; i < length; i++) {
+      curr_node->length_mask |= 1u << min(length - i, MAX_LENGTH_BIT);
+
+      TrieNode* next = curr_node->child(word[i] - 'a');
+      if (next == nullptr) {
+        next = curr_node->add_child(word[i] - 'a');
       }
 
-      curr_node = curr_node->children[word[i] - 'a'];
-      if (i == (int)word.length() - 1) {
+      curr_node = next;
+      if (i == length - 1) {
         curr_node->word_end = true;
+        curr_node->length_mask |= 1;
       }
     }
   }
@@ -64,25 +246,33 @@ public:
    *  Returns true if word exists in the
    *  data structure of a match can be found
    *  (in case there are '.' in the word).
-   *  @param pos  - the character of the word we are at
-   *  @param word - the word
+   *  @param pos   - the character of the word we are at
+   *  @param word  - the word
+   *  @param prune - skip subtrees without a word of the remaining length
+   *                 (see length_mask), which keeps '.'-heavy patterns from
+   *                 exploring branches that cannot match
    */
-  bool find_word(int pos, string word) {
+  bool find_word(int pos, const string& word, bool prune = true) const {
+    if (prune and !reaches(word.length() - pos)) {
+      return false;
+    }
+
     if (pos == (int)word.length() - 1) {
       // Base case - the last letter
 
       if (word[pos] == '.') {
         // Any char can match
 
-        for (int i = 0; i < (int)children.size(); i++) {
-          if (children[i] != nullptr and children[i]->word_end) {
+        for (int i = 0; i < num_children(); i++) {
+          if (children[i]->word_end) {
             return true;
           }
         }
 
         return false;
       } else {
-        return (children[word[pos] - 'a'] != nullptr and children[word[pos] - 'a']->word_end);
+        TrieNode* next = child(word[pos] - 'a');
+        return (next != nullptr and next->word_end);
       }
     }
 
@@ -90,59 +280,1646 @@ public:
     if (word[pos] == '.') {
       // Any char can match
 
-      for (int i = 0; i < (int)children.size(); i++) {
-        if (children[i] != nullptr and children[i]->find_word(pos + 1, word)) {
+      for (int i = 0; i < num_children(); i++) {
+        if (children[i]->find_word(pos + 1, word, prune)) {
           return true;
         }
       }
 
       return false;
     } else {
-      return (children[word[pos] - 'a'] == nullptr) ? false :
-              children[word[pos] - 'a']->find_word(pos + 1, word);
+      TrieNode* next = child(word[pos] - 'a');
+      return (next == nullptr) ? false : next->find_word(pos + 1, word, prune);
     }
   }
 
   /**
    *  Helper function.
    */
-  bool exists(string word) {
+  bool exists(const string& word) const {
     return find_word(0, word);
   }
 
+  /**
+   *  Coroutine version of exists. Matches the word depth-first with an
+   *  explicit stack of (node, position) pairs and suspends after
+   *  prefetching the children it is about to visit. A node is pruned by
+   *  length as in find_word when it is popped, once its prefetch has landed.
+   *  word must stay alive until the lookup finishes.
+   */
+  lookup_task exists_task(const string& word) const {
+    vector<pair<const TrieNode*, int>> stack;
+    stack.push_back({this, 0});
+
+    while (!stack.empty()) {
+      const TrieNode* curr_node = stack.back().first;
+      int pos = stack.back().second;
+      stack.pop_back();
+
+      if (!curr_node->reaches(word.length() - pos)) {
+        continue;  // No word of the remaining length below
+      }
+      if (pos == (int)word.length()) {
+        co_return true;  // reaches(0) - a word ends here
+      }
+
+      if (word[pos] == '.') {
+        // Any char can match - push in reverse to visit 'a' first
+        for (int i = curr_node->num_children() - 1; i >= 0; i--) {
+          __builtin_prefetch(curr_node->children[i]);
+          stack.push_back({curr_node->children[i], pos + 1});
+        }
+      } else {
+        TrieNode* next = curr_node->child(word[pos] - 'a');
+        if (next != nullptr) {
+          __builtin_prefetch(next);
+          stack.push_back({next, pos + 1});
+        }
+      }
+
+      co_await suspend_always();
+    }
+
+    co_return false;
+  }
+
+  /**
+   *  Answers a group of lookups with up to width of them in flight:
+   *  out[i] = exists(words[i]).
+   */
+  void exists_interleaved(const vector<string>& words, int width, vector<bool>& out) const {
+    out.assign(words.size(), false);
+    run_interleaved(words.size(), width, [this, &words](size_t i) { return exists_task(words[i]); }, out);
+  }
+
+  /**
+   *  Compiles the trie into a read-only double-array trie (see
+   *  DoubleArrayTrie) answering exists with the same results.
+   */
+  class DoubleArrayTrie freeze() const;
+
+  /**
+   *  Returns the number of nodes in the subtree.
+   */
+  size_t nodes() const {
+    size_t result = 1;
+    for (int i = 0; i < num_children(); i++) {
+      result += children[i]->nodes();
+    }
+    return result;
+  }
+
+  /**
+   *  Returns the bytes held by the subtree: the nodes and their child
+   *  arrays (allocator overhead not included).
+   */
+  size_t memory_bytes() const {
+    size_t result = sizeof(TrieNode) + num_children() * sizeof(TrieNode*);
+    for (int i = 0; i < num_children(); i++) {
+      result += children[i]->memory_bytes();
+    }
+    return result;
+  }
+
   /**
    *  Helper function to print
    *  all children of a node.
    */
   void print_children() {
-    for (int i = 0; i < (int)children.size(); i++) {
-      cout << children[i] << " ";
+    for (int i = 0; i < num_children(); i++) {
+      cout << children[i]->key << " ";
     } cout << endl;
   }
 };
 
 
 /**
- *  Driver program to test functionality.
+ *  Read-only trie compiled from a TrieNode by TrieNode::freeze into a
+ *  double array. Every state s owns a cell {base, check}: the child of s
+ *  for the letter c is the state t = base[s] + c, and it exists only if
+ *  check[t] == s. A transition is therefore two reads of one 8-byte cell
+ *  instead of a pointer chase across the heap. The bases are chosen so
+ *  that the children of different states never collide.
+ *
+ *  info[s] holds the letters of the children of s as a bitmap (for '.'
+ *  fan-out) and, in bit 31, whether a word ends at s. State 0 is the root.
+ *
+ *  Operations:
+ *    - Freeze complexity: O(n^2 * ALPHABET_SIZE) for n nodes in the worst
+ *      case - the first-free scan may try O(n) bases for every state -
+ *      but nearly linear in practice, as the used cells stay dense.
+ *    - Exact lookup complexity: O(L) for a word of length L.
  */
-int main(int argc, char** argv) {
-  ios::sync_with_stdio(false);
+class DoubleArrayTrie {
+private:
+  static const uint32_t WORD_END = 1u << 31;
+  static const int FREE = -1;       // check of a cell no state uses
+  static const int ROOT_CHECK = -2; // check of the root - never a parent
 
-  int queries;
-  cin >> queries;
+  class cell {
+  public:
+    int base;   // Children of this state are at base + letter
+    int check;  // The parent state, FREE or ROOT_CHECK
+  };
 
-  int type;
-  string word;
-  TrieNode* root = new TrieNode();  // Empty node (no key)
+  vector<cell> cells;
+  vector<uint32_t> info;  // Child bitmap, WORD_END if a word ends here
 
-  for (int i = 0; i < queries; i++) {
-    cin >> type >> word;
+  /**
+   *  Returns the smallest base >= 1 such that the cells base + c are free
+   *  for every letter c in bits, scanning from the first free cell.
+   */
+  int find_base(uint32_t bits, int& first_free) {
+    int first_letter = __builtin_ctz(bits);
+    while (first_free < (int)cells.size() and cells[first_free].check != FREE) {
+      first_free++;
+    }
 
-    if (type == 1) {
-      root->add(word);
-    } else {
-      cout << root->exists(word) << endl;
+    for (int base = max(1, first_free - first_letter); ; base++) {
+      if (base + ALPHABET_SIZE > (int)cells.size()) {
+        cells.resize(base + ALPHABET_SIZE, {0, FREE});
+      }
+
+      bool free = true;
+      for (uint32_t rest = bits; rest != 0 and free; rest &= rest - 1) {
+        free = (cells[base + __builtin_ctz(rest)].check == FREE);
+      }
+      if (free) {
+        return base;
+      }
+    }
+  }
+
+  bool find_word(int state, int pos, const string& word) const {
+    for (; pos < (int)word.length(); pos++) {
+      if (word[pos] == '.') {
+        // Any letter can match - try every child
+        for (uint32_t rest = info[state] & ~WORD_END; rest != 0; rest &= rest - 1) {
+          if (find_word(cells[state].base + __builtin_ctz(rest), pos + 1, word)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      unsigned c = word[pos] - 'a';
+      if (c >= ALPHABET_SIZE) {
+        return false;
+      }
+      int next = cells[state].base + c;
+      if (cells[next].check != state) {
+        return false;
+      }
+      state = next;
+    }
+
+    return info[state] & WORD_END;
+  }
+
+public:
+  DoubleArrayTrie() {
+    cells.assign(ALPHABET_SIZE + 1, {0, FREE});
+    cells[0].check = ROOT_CHECK;
+    info.assign(cells.size(), 0);
+  }
+
+  /**
+   *  Compiles the trie rooted at root, visiting the nodes breadth first.
+   */
+  explicit DoubleArrayTrie(const TrieNode& root) {
+    cells.assign(ALPHABET_SIZE + 1, {0, FREE});
+    cells[0].check = ROOT_CHECK;
+
+    vector<pair<const TrieNode*, int>> queue;
+    queue.push_back({&root, 0});
+    vector<uint32_t> state_info(cells.size(), 0);
+    int first_free = 1;
+
+    for (size_t head = 0; head < queue.size(); head++) {
+      const TrieNode* node = queue[head].first;
+      int state = queue[head].second;
+
+      if (node->child_bits != 0) {
+        int base = find_base(node->child_bits, first_free);
+        cells[state].base = base;
+
+        int i = 0;
+        for (uint32_t rest = node->child_bits; rest != 0; rest &= rest - 1, i++) {
+          int child = base + __builtin_ctz(rest);
+          cells[child].check = state;
+          queue.push_back({node->children[i], child});
+        }
+      }
+
+      state_info.resize(cells.size(), 0);
+      state_info[state] = node->child_bits | (node->word_end ? WORD_END : 0);
+    }
+
+    info = state_info;
+    info.resize(cells.size(), 0);
+  }
+
+  /**
+   *  Returns true if the word (possibly with '.' wildcards) matches a
+   *  word of the frozen trie. Same results as TrieNode::exists.
+   */
+  bool exists(const string& word) const {
+    return find_word(0, 0, word);
+  }
+
+  /**
+   *  Returns the number of cells, used or free.
+   */
+  size_t nodes() const {
+    return cells.size();
+  }
+
+  size_t memory_bytes() const {
+    return cells.size() * sizeof(cell) + info.size() * sizeof(uint32_t);
+  }
+};
+
+
+DoubleArrayTrie TrieNode::freeze() const {
+  return DoubleArrayTrie(*this);
+}
+
+
+/**
+ *  Succinct read-only trie in LOUDS (level-order unary degree sequence)
+ *  form, stored in a file and queried straight from an mmap of it - a
+ *  process can answer lookups as soon as the file is mapped, with no
+ *  parse step.
+ *
+ *  The nodes are numbered breadth first (the root is 0), so node v + 1 is
+ *  the child reached through edge v. The structure is:
+ *    - louds:    for every node, one 1 per child followed by a 0
+ *                (2 bits per node); the edges of node v start at bit
+ *                select0(v) + 1, which is edge number select0(v) + 1 - v
+ *    - terminal: one bit per node, set if a word ends there
+ *    - labels:   the letter of every edge, in breadth-first order
+ *  select0 uses a rank directory (the number of 1s before every 512-bit
+ *  block) and the block of every 512th 0, both about 0.2 bits per node.
+ *
+ *  File layout (integers in host byte order, sections 8-byte aligned):
+ *    louds_header, louds words, rank directory, select samples,
+ *    terminal words, labels
+ *
+ *  Operations:
+ *    - Write complexity: O(n) for a TrieNode of n nodes.
+ *    - Open complexity: O(1).
+ *    - Exact lookup complexity: O(L * ALPHABET_SIZE) for a word of length L.
+ */
+static const uint32_t LOUDS_VERSION = 1;
+
+class louds_header {
+public:
+  char magic[8];             // "LOUDS" padded with zeros
+  uint32_t version;          // LOUDS_VERSION
+  uint32_t block_bits;       // Bits per rank directory entry
+  uint64_t num_nodes;
+  uint64_t louds_bits;       // 2 * num_nodes - 1
+  uint64_t louds_offset;     // Byte offsets of the sections from the file start
+  uint64_t rank_offset;
+  uint64_t select_offset;
+  uint64_t terminal_offset;
+  uint64_t labels_offset;
+  uint64_t file_bytes;
+};
+
+class LoudsTrie {
+private:
+  static const uint64_t BLOCK_BITS = 512;   // Rank directory granularity
+  static const uint64_t SELECT_SAMPLE = 512; // A select sample every this many 0s
+
+  const char* base;    // Start of the mapping, NULL when closed
+  size_t length;
+  louds_header header;
+  const uint64_t* louds;
+  const uint64_t* rank;     // rank[b] = number of 1s before block b
+  const uint64_t* select;   // select[s] = block holding 0 number s * SELECT_SAMPLE + 1
+  const uint64_t* terminal;
+  const char* labels;
+
+  /**
+   *  Returns the position of the k-th 0 (k >= 1) of the louds bits.
+   */
+  uint64_t select0(uint64_t k) const {
+    uint64_t block = select[(k - 1) / SELECT_SAMPLE];
+    while ((block + 1) * BLOCK_BITS - rank[block + 1] < k) {
+      block++;
+    }
+
+    uint64_t remaining = k - (block * BLOCK_BITS - rank[block]);
+    for (uint64_t word = block * (BLOCK_BITS / 64); ; word++) {
+      uint64_t zeros = ~louds[word];
+      uint64_t count = __builtin_popcountll(zeros);
+      if (remaining <= count) {
+        for (uint64_t i = 1; i < remaining; i++) {
+          zeros &= zeros - 1;
+        }
+        return word * 64 + __builtin_ctzll(zeros);
+      }
+      remaining -= count;
+    }
+  }
+
+  /**
+   *  Returns the number of children of the node whose edges start at bit
+   *  position: the run of 1s before the next 0.
+   */
+  uint64_t degree(uint64_t position) const {
+    uint64_t word = position / 64;
+    uint64_t zeros = ~louds[word] >> (position % 64);
+    if (zeros != 0) {
+      return __builtin_ctzll(zeros);
+    }
+
+    uint64_t result = 64 - position % 64;
+    while (~louds[++word] == 0) {
+      result += 64;
+    }
+    return result + __builtin_ctzll(~louds[word]);
+  }
+
+  bool is_terminal(uint64_t node) const {
+    return (terminal[node / 64] >> (node % 64)) & 1;
+  }
+
+  bool find_word(uint64_t node, size_t pos, const string& word) const {
+    for (; pos < word.length(); pos++) {
+      uint64_t position = (node == 0) ? 0 : select0(node) + 1;
+      uint64_t first_edge = position - node;
+      uint64_t count = degree(position);
+
+      if (word[pos] == '.') {
+        // Any letter can match - try every edge
+        for (uint64_t e = first_edge; e < first_edge + count; e++) {
+          if (find_word(e + 1, pos + 1, word)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      uint64_t e = first_edge;
+      while (e < first_edge + count and labels[e] != word[pos]) {
+        e++;
+      }
+      if (e == first_edge + count) {
+        return false;
+      }
+      node = e + 1;
+    }
+
+    return is_terminal(node);
+  }
+
+  /**
+   *  Returns true if a section of the given size can start at offset: it
+   *  must be 8-byte aligned, not overlap the sections before, which end
+   *  at end, and fit in the first limit bytes. Moves end past the section.
+   */
+  static bool section_fits(uint64_t offset, uint64_t bytes, uint64_t& end, uint64_t limit) {
+    if (offset % 8 != 0 or offset < end or bytes > limit or offset > limit - bytes) {
+      return false;
+    }
+    end = offset + bytes;
+    return true;
+  }
+
+  /**
+   *  Appends the bytes of the vector to the file, padded to 8 bytes.
+   */
+  template <class T>
+  static bool write_section(FILE* file, const vector<T>& data, uint64_t& offset) {
+    size_t bytes = data.size() * sizeof(T);
+    size_t padding = (8 - bytes % 8) % 8;
+    char zeros[8] = {0};
+
+    bool ok = (bytes == 0 or fwrite(data.data(), bytes, 1, file) == 1)
+          and (padding == 0 or fwrite(zeros, padding, 1, file) == 1);
+    offset += bytes + padding;
+    return ok;
+  }
+
+public:
+  LoudsTrie() {
+    base = NULL;
+    length = 0;
+  }
+
+  ~LoudsTrie() {
+    close();
+  }
+
+  LoudsTrie(const LoudsTrie&) = delete;
+  LoudsTrie& operator=(const LoudsTrie&) = delete;
+
+  /**
+   *  Encodes the trie rooted at root and writes it to the file at path,
+   *  replacing any previous file atomically.
+   *  Returns false (leaving the previous file in place) if it cannot be written.
+   */
+  static bool write(const char* path, const TrieNode& root) {
+    vector<uint64_t> louds_words, terminal_words;
+    vector<char> label_bytes;
+    uint64_t bits = 0, num_nodes = 0;
+
+    // Breadth-first walk: the queue order is the node numbering
+    vector<const TrieNode*> queue;
+    queue.push_back(&root);
+    for (size_t head = 0; head < queue.size(); head++, num_nodes++) {
+      const TrieNode* node = queue[head];
+
+      if (num_nodes % 64 == 0) {
+        terminal_words.push_back(0);
+      }
+      terminal_words.back() |= (uint64_t)node->word_end << (num_nodes % 64);
+
+      int i = 0;
+      for (uint32_t rest = node->child_bits; rest != 0; rest &= rest - 1, i++) {
+        if (bits % 64 == 0) {
+          louds_words.push_back(0);
+        }
+        louds_words.back() |= 1ull << (bits++ % 64);
+        label_bytes.push_back('a' + __builtin_ctz(rest));
+        queue.push_back(node->children[i]);
+      }
+
+      if (bits % 64 == 0) {
+        louds_words.push_back(0);
+      }
+      bits++; // The 0 closing the node
     }
+
+    // Pad to whole blocks with 1s so the padding never counts as a 0
+    uint64_t blocks = (bits + BLOCK_BITS - 1) / BLOCK_BITS;
+    if (bits % 64 != 0) {
+      louds_words.back() |= ~0ull << (bits % 64);
+    }
+    louds_words.resize(blocks * (BLOCK_BITS / 64), ~0ull);
+
+    vector<uint64_t> rank_entries(blocks + 1, 0);
+    vector<uint64_t> select_entries;
+    uint64_t ones = 0, zeros = 0;
+    for (uint64_t b = 0; b < blocks; b++) {
+      rank_entries[b] = ones;
+      for (uint64_t w = b * (BLOCK_BITS / 64); w < (b + 1) * (BLOCK_BITS / 64); w++) {
+        uint64_t count = __builtin_popcountll(louds_words[w]);
+        // A sample for every 0 number s * SELECT_SAMPLE + 1 inside this word
+        while (zeros + (64 - count) > select_entries.size() * SELECT_SAMPLE) {
+          select_entries.push_back(b);
+        }
+        ones += count;
+        zeros += 64 - count;
+      }
+    }
+    rank_entries[blocks] = ones;
+
+    louds_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LOUDS", 5);
+    header.version = LOUDS_VERSION;
+    header.block_bits = BLOCK_BITS;
+    header.num_nodes = num_nodes;
+    header.louds_bits = bits;
+
+    // Write path.tmp and rename it over path at the end, so a process
+    // still mapping the old file keeps reading it intact
+    string temp_path = string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL) {
+      return false;
+    }
+
+    uint64_t offset = sizeof(louds_header);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    header.louds_offset = offset;
+    ok = write_section(file, louds_words, offset) and ok;
+    header.rank_offset = offset;
+    ok = write_section(file, rank_entries, offset) and ok;
+    header.select_offset = offset;
+    ok = write_section(file, select_entries, offset) and ok;
+    header.terminal_offset = offset;
+    ok = write_section(file, terminal_words, offset) and ok;
+    header.labels_offset = offset;
+    ok = write_section(file, label_bytes, offset) and ok;
+    header.file_bytes = offset;
+
+    // Now that the offsets are known, write the header again
+    ok = fseek(file, 0, SEEK_SET) == 0 and fwrite(&header, sizeof(header), 1, file) == 1 and ok;
+    ok = fflush(file) == 0 and fsync(fileno(file)) == 0 and ok;
+    ok = (fclose(file) == 0) and ok;
+
+    if (!ok or rename(temp_path.c_str(), path) != 0) {
+      remove(temp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   *  Maps the file at path. Only the header is read. Returns false if the
+   *  file is missing, truncated, written by another format version, or if
+   *  its section offsets do not match the node count. The section contents
+   *  are trusted.
+   */
+  bool open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 or (size_t)info.st_size < sizeof(louds_header)) {
+      ::close(fd);
+      return false;
+    }
+
+    length = info.st_size;
+    void* mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+      return false;
+    }
+    base = (const char*)mapping;
+    memcpy(&header, base, sizeof(header));
+
+    bool valid = memcmp(header.magic, "LOUDS\0\0\0", 8) == 0
+             and header.version == LOUDS_VERSION
+             and header.block_bits == BLOCK_BITS
+             and header.file_bytes == length
+             and header.num_nodes > 0 and header.num_nodes <= length  // Every edge has a label byte
+             and header.louds_bits == 2 * header.num_nodes - 1;
+
+    // The sections must be aligned, in order and as long as the counts require
+    if (valid) {
+      uint64_t blocks = (header.louds_bits + BLOCK_BITS - 1) / BLOCK_BITS;
+      uint64_t end = sizeof(louds_header);
+      valid = section_fits(header.louds_offset, blocks * BLOCK_BITS / 8, end, length)
+          and section_fits(header.rank_offset, (blocks + 1) * sizeof(uint64_t), end, length)
+          and section_fits(header.select_offset, (header.num_nodes + SELECT_SAMPLE - 1) / SELECT_SAMPLE * sizeof(uint64_t), end, length)
+          and section_fits(header.terminal_offset, (header.num_nodes + 63) / 64 * sizeof(uint64_t), end, length)
+          and section_fits(header.labels_offset, header.num_nodes - 1, end, length);
+    }
+    if (!valid) {
+      close();
+      return false;
+    }
+
+    louds = (const uint64_t*)(base + header.louds_offset);
+    rank = (const uint64_t*)(base + header.rank_offset);
+    select = (const uint64_t*)(base + header.select_offset);
+    terminal = (const uint64_t*)(base + header.terminal_offset);
+    labels = base + header.labels_offset;
+    return true;
+  }
+
+  void close() {
+    if (base != NULL) {
+      munmap((void*)base, length);
+      base = NULL;
+    }
+  }
+
+  /**
+   *  Returns true if the word (possibly with '.' wildcards) matches a
+   *  word of the encoded trie. Same results as TrieNode::exists.
+   */
+  bool exists(const string& word) const {
+    return !word.empty() and find_word(0, 0, word);
+  }
+
+  size_t nodes() const {
+    return header.num_nodes;
+  }
+
+  /**
+   *  Returns the size of the file, all of which is mapped.
+   */
+  size_t memory_bytes() const {
+    return length;
+  }
+};
+
+
+/**
+ *  Path-compressed (radix, Patricia) trie over the same alphabet.
+ *  A chain of single-child nodes collapses into one edge labelled with the
+ *  whole slice of letters, so a long unique suffix costs one node instead
+ *  of one node per letter, and a lookup follows one pointer per edge.
+ *
+ *  Labels are slices [label_start, label_start + label_length) of one
+ *  shared arena holding the suffixes of the added words. Splitting an edge
+ *  when a new word diverges in its middle only splits the slice.
+ *  Children are packed behind a bitmap of their first letters as in TrieNode.
+ *
+ *  Operations:
+ *    - Add complexity: O(L) for a word of length L.
+ *    - Exact lookup complexity: O(L), one node per edge.
+ *    - '.' matches any letter, also inside a label.
+ */
+class RadixTrie {
+private:
+  class Node {
+  public:
+    uint32_t label_start;   // The edge label into this node, in the arena
+    uint32_t label_length;
+    bool word_end;          // true if a word ends at this node
+    uint32_t child_bits;    // Bit c set if a child label starts with letter c
+    Node** children;        // popcount(child_bits) children in letter order
+
+    Node(uint32_t label_start, uint32_t label_length) {
+      this->label_start = label_start;
+      this->label_length = label_length;
+      word_end = false;
+      child_bits = 0;
+      children = nullptr;
+    }
+
+    ~Node() {
+      for (int i = 0; i < num_children(); i++) {
+        delete children[i];
+      }
+      delete[] children;
+    }
+
+    int num_children() const {
+      return __builtin_popcount(child_bits);
+    }
+
+    int slot(int c) const {
+      return __builtin_popcount(child_bits & ((1u << c) - 1));
+    }
+
+    Node* child(int c) const {
+      return (child_bits & (1u << c)) ? children[slot(c)] : nullptr;
+    }
+
+    /**
+     *  Adds the child whose label starts with the letter c (not present yet).
+     */
+    void add_child(int c, Node* node) {
+      int count = num_children();
+      int pos = slot(c);
+
+      Node** grown = new Node*[count + 1];
+      for (int i = 0; i < pos; i++) {
+        grown[i] = children[i];
+      }
+      grown[pos] = node;
+      for (int i = pos; i < count; i++) {
+        grown[i + 1] = children[i];
+      }
+
+      delete[] children;
+      children = grown;
+      child_bits |= 1u << c;
+    }
+  };
+
+  Node* root;   // Empty label
+  string arena; // Storage of every edge label
+
+  /**
+   *  Returns true if the label of node matches word from pos on, with '.'
+   *  in the word matching any letter.
+   */
+  bool label_matches(const Node* node, int pos, const string& word) const {
+    if (pos + node->label_length > word.length()) {
+      return false;
+    }
+
+    const char* label = arena.data() + node->label_start;
+    for (uint32_t k = 0; k < node->label_length; k++) {
+      if (word[pos + k] != label[k] and word[pos + k] != '.') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool find_word(const Node* node, int pos, const string& word) const {
+    if (pos == (int)word.length()) {
+      return node->word_end;
+    }
+
+    if (word[pos] == '.') {
+      // Any first letter can match
+      for (int i = 0; i < node->num_children(); i++) {
+        const Node* next = node->children[i];
+        if (label_matches(next, pos, word) and find_word(next, pos + next->label_length, word)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    const Node* next = node->child(word[pos] - 'a');
+    if (next == nullptr or !label_matches(next, pos, word)) {
+      return false;
+    }
+    return find_word(next, pos + next->label_length, word);
+  }
+
+  void count(const Node* node, size_t& nodes, size_t& bytes) const {
+    nodes++;
+    bytes += sizeof(Node) + node->num_children() * sizeof(Node*);
+    for (int i = 0; i < node->num_children(); i++) {
+      count(node->children[i], nodes, bytes);
+    }
+  }
+
+public:
+  RadixTrie() {
+    root = new Node(0, 0);
+  }
+
+  ~RadixTrie() {
+    delete root;
+  }
+
+  RadixTrie(const RadixTrie&) = delete;
+  RadixTrie& operator=(const RadixTrie&) = delete;
+
+  /**
+   *  Adds a word of lowercase letters.
+   */
+  void add(const string& word) {
+    if (word.empty()) {
+      return; // Like TrieNode, the empty word is not stored
+    }
+
+    Node* curr_node = root;
+    int pos = 0;
+
+    while (pos < (int)word.length()) {
+      int c = word[pos] - 'a';
+      Node* next = curr_node->child(c);
+
+      if (next == nullptr) {
+        // New edge with the rest of the word as its label
+        Node* leaf = new Node(arena.size(), word.length() - pos);
+        arena.append(word, pos, string::npos);
+        leaf->word_end = true;
+        curr_node->add_child(c, leaf);
+        return;
+      }
+
+      // Length of the common prefix of the label and the rest of the word
+      const char* label = arena.data() + next->label_start;
+      uint32_t k = 0;
+      while (k < next->label_length and pos + k < word.length() and label[k] == word[pos + k]) {
+        k++;
+      }
+
+      if (k < next->label_length) {
+        // The word leaves the label in its middle - split the edge at k
+        Node* middle = new Node(next->label_start, k);
+        next->label_start += k;
+        next->label_length -= k;
+        middle->add_child(arena[next->label_start] - 'a', next);
+        curr_node->children[curr_node->slot(c)] = middle;
+        next = middle;
+      }
+
+      curr_node = next;
+      pos += k;
+    }
+
+    curr_node->word_end = true;
+  }
+
+  /**
+   *  Returns true if the word (possibly with '.' wildcards) matches an added word.
+   */
+  bool exists(const string& word) const {
+    return find_word(root, 0, word);
+  }
+
+  size_t nodes() const {
+    size_t nodes = 0, bytes = 0;
+    count(root, nodes, bytes);
+    return nodes;
+  }
+
+  /**
+   *  Returns the bytes held by the nodes, their child arrays and the
+   *  label arena (allocator overhead not included).
+   */
+  size_t memory_bytes() const {
+    size_t nodes = 0, bytes = 0;
+    count(root, nodes, bytes);
+    return bytes + arena.capacity();
+  }
+};
+
+
+/**
+ *  Adaptive radix tree (ART) over arbitrary byte strings.
+ *  Every inner node picks the smallest of four layouts that fits its
+ *  children, so the fan-out is 256 without 256 slots per node:
+ *    - Node4:   up to 4 key bytes and 4 children, searched linearly
+ *    - Node16:  up to 16 key bytes, searched with one SSE2 compare
+ *    - Node48:  a 256-entry byte index into 48 children
+ *    - Node256: 256 children indexed directly by the byte
+ *  A node grows into the next layout when it is full. Chains of single
+ *  children are compressed into a prefix stored (as in RadixTrie) as a
+ *  slice of a shared arena.
+ *
+ *  A word is any byte string - no byte is reserved. In queries '.' still
+ *  matches any byte, so a stored '.' is found by '.' as well.
+ *
+ *  Operations:
+ *    - Add complexity: O(L) for a word of length L.
+ *    - Exact lookup complexity: O(L), one node per distinct prefix branch.
+ */
+class ArtTrie {
+private:
+  enum node_type : uint8_t { NODE4, NODE16, NODE48, NODE256 };
+
+  class Node {
+  public:
+    node_type type;
+    bool word_end;          // true if a word ends after the prefix
+    uint16_t count;         // Number of children
+    uint32_t prefix_start;  // Bytes every word below shares, in the arena
+    uint32_t prefix_length;
+  };
+
+  class Node4 : public Node {
+  public:
+    uint8_t keys[4];
+    Node* children[4];
+  };
+
+  class Node16 : public Node {
+  public:
+    uint8_t keys[16];
+    Node* children[16];
+  };
+
+  class Node48 : public Node {
+  public:
+    uint8_t index[256];     // 0 if there is no child, else its slot + 1
+    Node* children[48];
+  };
+
+  class Node256 : public Node {
+  public:
+    Node* children[256];
+  };
+
+  Node* root;
+  string arena;  // Storage of every prefix
+
+  static Node4* new_node4(uint32_t prefix_start, uint32_t prefix_length) {
+    Node4* node = new Node4();
+    node->type = NODE4;
+    node->word_end = false;
+    node->count = 0;
+    node->prefix_start = prefix_start;
+    node->prefix_length = prefix_length;
+    return node;
+  }
+
+  /**
+   *  Copies the header of from into to, as the first step of growing from.
+   */
+  static void copy_header(const Node* from, Node* to, node_type type) {
+    to->type = type;
+    to->word_end = from->word_end;
+    to->count = from->count;
+    to->prefix_start = from->prefix_start;
+    to->prefix_length = from->prefix_length;
+  }
+
+  /**
+   *  Returns the slot holding the child for byte b, nullptr if there is none.
+   */
+  static Node** find_child(Node* node, uint8_t b) {
+    switch (node->type) {
+      case NODE4: {
+        Node4* n = (Node4*)node;
+        for (int i = 0; i < n->count; i++) {
+          if (n->keys[i] == b) {
+            return &n->children[i];
+          }
+        }
+        return nullptr;
+      }
+      case NODE16: {
+        Node16* n = (Node16*)node;
+#ifdef __SSE2__
+        __m128i equal = _mm_cmpeq_epi8(_mm_set1_epi8(b), _mm_loadu_si128((const __m128i*)n->keys));
+        unsigned matches = _mm_movemask_epi8(equal) & ((1u << n->count) - 1);
+        return matches ? &n->children[__builtin_ctz(matches)] : nullptr;
+#else
+        for (int i = 0; i < n->count; i++) {
+          if (n->keys[i] == b) {
+            return &n->children[i];
+          }
+        }
+        return nullptr;
+#endif
+      }
+      case NODE48: {
+        Node48* n = (Node48*)node;
+        return n->index[b] ? &n->children[n->index[b] - 1] : nullptr;
+      }
+      default: {
+        Node256* n = (Node256*)node;
+        return n->children[b] ? &n->children[b] : nullptr;
+      }
+    }
+  }
+
+  /**
+   *  Adds child under byte b (not present yet) to the node in *slot,
+   *  replacing it by a larger layout if it is full.
+   */
+  static void add_child(Node** slot, uint8_t b, Node* child) {
+    Node* node = *slot;
+
+    switch (node->type) {
+      case NODE4: {
+        Node4* n = (Node4*)node;
+        if (n->count < 4) {
+          n->keys[n->count] = b;
+          n->children[n->count++] = child;
+          return;
+        }
+
+        Node16* grown = new Node16();
+        copy_header(n, grown, NODE16);
+        for (int i = 0; i < 4; i++) {
+          grown->keys[i] = n->keys[i];
+          grown->children[i] = n->children[i];
+        }
+        delete n;
+        *slot = grown;
+        add_child(slot, b, child);
+        return;
+      }
+      case NODE16: {
+        Node16* n = (Node16*)node;
+        if (n->count < 16) {
+          n->keys[n->count] = b;
+          n->children[n->count++] = child;
+          return;
+        }
+
+        Node48* grown = new Node48();
+        copy_header(n, grown, NODE48);
+        for (int i = 0; i < 16; i++) {
+          grown->index[n->keys[i]] = i + 1;
+          grown->children[i] = n->children[i];
+        }
+        delete n;
+        *slot = grown;
+        add_child(slot, b, child);
+        return;
+      }
+      case NODE48: {
+        Node48* n = (Node48*)node;
+        if (n->count < 48) {
+          n->children[n->count] = child;
+          n->index[b] = ++n->count;
+          return;
+        }
+
+        Node256* grown = new Node256();
+        copy_header(n, grown, NODE256);
+        for (int c = 0; c < 256; c++) {
+          if (n->index[c]) {
+            grown->children[c] = n->children[n->index[c] - 1];
+          }
+        }
+        delete n;
+        *slot = grown;
+        add_child(slot, b, child);
+        return;
+      }
+      default: {
+        Node256* n = (Node256*)node;
+        n->children[b] = child;
+        n->count++;
+        return;
+      }
+    }
+  }
+
+  /**
+   *  Calls visit(child) for every child of the node until one returns true.
+   *  Returns true if one did.
+   */
+  template <class Visit>
+  static bool any_child(const Node* node, Visit visit) {
+    switch (node->type) {
+      case NODE4:
+        for (int i = 0; i < node->count; i++) {
+          if (visit(((const Node4*)node)->children[i])) {
+            return true;
+          }
+        }
+        return false;
+      case NODE16:
+        for (int i = 0; i < node->count; i++) {
+          if (visit(((const Node16*)node)->children[i])) {
+            return true;
+          }
+        }
+        return false;
+      case NODE48:
+        for (int i = 0; i < node->count; i++) {
+          if (visit(((const Node48*)node)->children[i])) {
+            return true;
+          }
+        }
+        return false;
+      default:
+        for (int c = 0; c < 256; c++) {
+          const Node* child = ((const Node256*)node)->children[c];
+          if (child != nullptr and visit(child)) {
+            return true;
+          }
+        }
+        return false;
+    }
+  }
+
+  static size_t node_bytes(const Node* node) {
+    switch (node->type) {
+      case NODE4: return sizeof(Node4);
+      case NODE16: return sizeof(Node16);
+      case NODE48: return sizeof(Node48);
+      default: return sizeof(Node256);
+    }
+  }
+
+  static void destroy(Node* node) {
+    any_child(node, [](const Node* child) { destroy((Node*)child); return false; });
+
+    switch (node->type) {
+      case NODE4: delete (Node4*)node; break;
+      case NODE16: delete (Node16*)node; break;
+      case NODE48: delete (Node48*)node; break;
+      default: delete (Node256*)node; break;
+    }
+  }
+
+  bool find_word(const Node* node, size_t pos, const string& word) const {
+    // The prefix must match, '.' matching any byte
+    if (pos + node->prefix_length > word.length()) {
+      return false;
+    }
+    const char* prefix = arena.data() + node->prefix_start;
+    for (uint32_t k = 0; k < node->prefix_length; k++) {
+      if (word[pos + k] != prefix[k] and word[pos + k] != '.') {
+        return false;
+      }
+    }
+    pos += node->prefix_length;
+
+    if (pos == word.length()) {
+      return node->word_end;
+    }
+
+    if (word[pos] == '.') {
+      return any_child(node, [&](const Node* child) { return find_word(child, pos + 1, word); });
+    }
+
+    Node** child = find_child((Node*)node, word[pos]);
+    return child != nullptr and find_word(*child, pos + 1, word);
+  }
+
+  void count(const Node* node, size_t& nodes, size_t& bytes) const {
+    nodes++;
+    bytes += node_bytes(node);
+    any_child(node, [&](const Node* child) { count(child, nodes, bytes); return false; });
+  }
+
+public:
+  ArtTrie() {
+    root = new_node4(0, 0);
+  }
+
+  ~ArtTrie() {
+    destroy(root);
+  }
+
+  ArtTrie(const ArtTrie&) = delete;
+  ArtTrie& operator=(const ArtTrie&) = delete;
+
+  /**
+   *  Adds a word made of any bytes.
+   */
+  void add(const string& word) {
+    if (word.empty()) {
+      return; // Like TrieNode, the empty word is not stored
+    }
+
+    Node** slot = &root;
+    size_t pos = 0;
+
+    while (true) {
+      Node* node = *slot;
+
+      // Length of the common part of the prefix and the rest of the word
+      const char* prefix = arena.data() + node->prefix_start;
+      uint32_t k = 0;
+      while (k < node->prefix_length and pos + k < word.length() and prefix[k] == word[pos + k]) {
+        k++;
+      }
+
+      if (k < node->prefix_length) {
+        // The word leaves the prefix in its middle - split it at k:
+        // a new Node4 keeps prefix[0..k), the node hangs below it
+        Node4* parent = new_node4(node->prefix_start, k);
+        uint8_t b = prefix[k];
+        node->prefix_start += k + 1;
+        node->prefix_length -= k + 1;
+        add_child((Node**)&parent, b, node);
+        *slot = parent;
+        node = parent;
+      }
+      pos += k;
+
+      if (pos == word.length()) {
+        node->word_end = true;
+        return;
+      }
+
+      Node** child = find_child(node, word[pos]);
+      if (child == nullptr) {
+        // New leaf holding the rest of the word as its prefix
+        Node4* leaf = new_node4(arena.size(), word.length() - pos - 1);
+        arena.append(word, pos + 1, string::npos);
+        leaf->word_end = true;
+        add_child(slot, word[pos], leaf);
+        return;
+      }
+
+      slot = child;
+      pos++;
+    }
+  }
+
+  /**
+   *  Returns true if the word (possibly with '.' wildcards) matches an added word.
+   */
+  bool exists(const string& word) const {
+    return find_word(root, 0, word);
+  }
+
+  size_t nodes() const {
+    size_t nodes = 0, bytes = 0;
+    count(root, nodes, bytes);
+    return nodes;
+  }
+
+  /**
+   *  Returns the bytes held by the nodes and the prefix arena
+   *  (allocator overhead not included).
+   */
+  size_t memory_bytes() const {
+    size_t nodes = 0, bytes = 0;
+    count(root, nodes, bytes);
+    return bytes + arena.capacity();
+  }
+};
+
+
+// ===========================  Benchmark  ===============================
+
+
+typedef chrono::steady_clock bench_clock;
+
+static double elapsed_ms(bench_clock::time_point start) {
+  return chrono::duration<double, milli>(bench_clock::now() - start).count();
+}
+
+/**
+ *  Returns a random word of 3 to max_length letters. With probability
+ *  dot_chance each letter is replaced by '.'.
+ */
+static string random_word(mt19937& rng, double dot_chance, int max_length = 12) {
+  int length = uniform_int_distribution<int>(3, max_length)(rng);
+  string word(length, 'a');
+
+  for (int i = 0; i < length; i++) {
+    word[i] = 'a' + uniform_int_distribution<int>(0, ALPHABET_SIZE - 1)(rng);
+    if (uniform_real_distribution<double>(0, 1)(rng) < dot_chance) {
+      word[i] = '.';
+    }
+  }
+
+  return word;
+}
+
+/**
+ *  Builds a trie of n random words and times n lookups (half of them
+ *  words from the trie) one at a time and with 1 to 32 coroutines in flight.
+ */
+static void run_benchmark(int n) {
+  mt19937 rng(12345);
+
+  vector<string> words(n);
+  TrieNode* root = new TrieNode();
+  for (int i = 0; i < n; i++) {
+    words[i] = random_word(rng, 0);
+    root->add(words[i]);
+  }
+
+  vector<string> queries(n);
+  for (int i = 0; i < n; i++) {
+    queries[i] = (i % 2 == 0) ? words[rng() % n] : random_word(rng, 0);
+  }
+
+  size_t num_nodes = root->nodes();
+  cout << "exact lookups, n = " << n << endl;
+  cout << "  " << num_nodes << " nodes, " << (double)root->memory_bytes() / num_nodes << " bytes/node" << endl;
+
+  bench_clock::time_point start = bench_clock::now();
+  int hits = 0;
+  for (int i = 0; i < n; i++) {
+    hits += root->exists(queries[i]);
+  }
+  cout << "  exists: " << elapsed_ms(start) * 1e6 / n << " ns/op (" << hits << " hits)" << endl;
+
+  int widths[] = {1, 2, 4, 8, 12, 16, 24, 32};
+  vector<bool> found;
+  for (int w = 0; w < 8; w++) {
+    start = bench_clock::now();
+    root->exists_interleaved(queries, widths[w], found);
+    double find_ms = elapsed_ms(start);
+
+    hits = 0;
+    for (int i = 0; i < n; i++) {
+      hits += found[i];
+    }
+    cout << "  coroutines, width " << widths[w] << ": " << find_ms * 1e6 / n
+         << " ns/op (" << hits << " hits)" << endl;
+  }
+
+  // Dot-heavy patterns: every letter is '.' with probability 0.6, of the
+  // same lengths as the words (3-12) and of 3-16 letters. The unpruned
+  // search is slow, so only n / 100 patterns are timed.
+  int num_patterns = max(1, n / 100);
+  int max_lengths[] = {12, 16};
+  for (int m = 0; m < 2; m++) {
+    vector<string> patterns(num_patterns);
+    for (int i = 0; i < num_patterns; i++) {
+      patterns[i] = random_word(rng, 0.6, max_lengths[m]);
+    }
+
+    cout << "wildcard lookups, 60% dots, 3-" << max_lengths[m] << " letters" << endl;
+    for (int prune = 1; prune >= 0; prune--) {
+      start = bench_clock::now();
+      hits = 0;
+      for (int i = 0; i < num_patterns; i++) {
+        hits += root->find_word(0, patterns[i], prune);
+      }
+      cout << "  " << (prune ? "pruned by length: " : "unpruned: ") << elapsed_ms(start) * 1e6 / num_patterns
+           << " ns/op (" << hits << " hits)" << endl;
+    }
+  }
+
+  delete root;
+}
+
+
+/**
+ *  Returns n identifier-like words: 2 to 5 parts drawn from a vocabulary
+ *  of 500 random syllable groups followed by a random suffix of up to 8
+ *  letters - long shared prefixes and mostly unique tails.
+ */
+static vector<string> random_identifiers(mt19937& rng, int n) {
+  vector<string> vocabulary(500);
+  for (int i = 0; i < (int)vocabulary.size(); i++) {
+    vocabulary[i] = random_word(rng, 0).substr(0, 3 + rng() % 6);
+  }
+
+  vector<string> words(n);
+  for (int i = 0; i < n; i++) {
+    int parts = 2 + rng() % 4;
+    for (int p = 0; p < parts; p++) {
+      words[i] += vocabulary[rng() % vocabulary.size()];
+    }
+    int suffix = rng() % 9;
+    for (int k = 0; k < suffix; k++) {
+      words[i] += 'a' + rng() % ALPHABET_SIZE;
+    }
+  }
+  return words;
+}
+
+/**
+ *  Returns a copy of word with every letter replaced by '.' with probability dot_chance.
+ */
+static string with_dots(mt19937& rng, const string& word, double dot_chance) {
+  string result = word;
+  for (int i = 0; i < (int)result.length(); i++) {
+    if (uniform_real_distribution<double>(0, 1)(rng) < dot_chance) {
+      result[i] = '.';
+    }
+  }
+  return result;
+}
+
+/**
+ *  Adds the words to the trie and times exact and wildcard lookups.
+ *  Prints the memory use and the latency of both query kinds.
+ */
+template <class Trie>
+static void bench_lookups(const char* engine, const Trie& trie, size_t num_words, double build_ms,
+                          const vector<string>& exact, const vector<string>& wildcard) {
+  bench_clock::time_point start = bench_clock::now();
+  int exact_hits = 0;
+  for (int i = 0; i < (int)exact.size(); i++) {
+    exact_hits += trie.exists(exact[i]);
+  }
+  double exact_ms = elapsed_ms(start);
+
+  start = bench_clock::now();
+  int wildcard_hits = 0;
+  for (int i = 0; i < (int)wildcard.size(); i++) {
+    wildcard_hits += trie.exists(wildcard[i]);
+  }
+  double wildcard_ms = elapsed_ms(start);
+
+  size_t bytes = trie.memory_bytes();
+  cout << "  " << engine << ": " << trie.nodes() << " nodes, " << bytes / (1 << 20) << " MiB ("
+       << (double)bytes / num_words << " bytes/word), build " << build_ms << " ms" << endl;
+  cout << "    exact " << exact_ms * 1e6 / exact.size() << " ns/op (" << exact_hits << " hits), "
+       << "wildcard " << wildcard_ms * 1e6 / wildcard.size() << " ns/op (" << wildcard_hits << " hits)" << endl;
+}
+
+template <class Trie>
+static void bench_trie(const char* engine, Trie& trie, const vector<string>& words,
+                       const vector<string>& exact, const vector<string>& wildcard) {
+  bench_clock::time_point start = bench_clock::now();
+  for (int i = 0; i < (int)words.size(); i++) {
+    trie.add(words[i]);
+  }
+  bench_lookups(engine, trie, words.size(), elapsed_ms(start), exact, wildcard);
+}
+
+/**
+ *  Compares the trie engines on n identifier-like words (see random_identifiers).
+ *  Half of the exact lookups are added words; the wildcard lookups are
+ *  added words with 10% of their letters replaced by '.'.
+ */
+static void run_engine_benchmark(int n) {
+  mt19937 rng(12345);
+  vector<string> words = random_identifiers(rng, n);
+
+  int num_lookups = min(n, 1000000);
+  vector<string> exact(num_lookups), wildcard(num_lookups);
+  for (int i = 0; i < num_lookups; i++) {
+    const string& word = words[rng() % n];
+    exact[i] = (i % 2 == 0) ? word : word + (char)('a' + rng() % ALPHABET_SIZE);
+    wildcard[i] = with_dots(rng, words[rng() % n], 0.1);
+  }
+
+  cout << "identifier corpus, n = " << n << endl;
+  {
+    TrieNode trie;
+    bench_trie("trie", trie, words, exact, wildcard);
+
+    bench_clock::time_point start = bench_clock::now();
+    DoubleArrayTrie frozen = trie.freeze();
+    bench_lookups("frozen (from trie)", frozen, words.size(), elapsed_ms(start), exact, wildcard);
+
+    const char* path = "trie-bench.louds";
+    start = bench_clock::now();
+    LoudsTrie::write(path, trie);
+    double write_ms = elapsed_ms(start);
+
+    start = bench_clock::now();
+    LoudsTrie louds;
+    if (louds.open(path)) {
+      cout << "  louds: file written in " << write_ms << " ms, opened in " << elapsed_ms(start) << " ms, "
+           << louds.memory_bytes() * 8.0 / louds.nodes() << " bits/node with labels" << endl;
+      bench_lookups("louds (from trie)", louds, words.size(), write_ms, exact, wildcard);
+    }
+    remove(path);
+  }
+  {
+    RadixTrie trie;
+    bench_trie("radix", trie, words, exact, wildcard);
+  }
+  {
+    ArtTrie trie;
+    bench_trie("art", trie, words, exact, wildcard);
+  }
+}
+
+
+/**
+ *  Answers the queries from stdin (see main) with the given engine.
+ */
+template <class Trie>
+static void answer_queries(Trie& trie) {
+  int queries;
+  cin >> queries;
+
+  int type;
+  string word;
+  for (int i = 0; i < queries; i++) {
+    cin >> type >> word;
+
+    if (type == 1) {
+      trie.add(word);
+    } else {
+      cout << trie.exists(word) << endl;
+    }
+  }
+}
+
+
+/**
+ *  Answers the queries from stdin (see main): words are added to a
+ *  TrieNode, which is frozen again before the first lookup after any add.
+ */
+static void answer_frozen_queries() {
+  int queries;
+  cin >> queries;
+
+  TrieNode trie;
+  DoubleArrayTrie frozen;
+  bool stale = false;
+
+  int type;
+  string word;
+  for (int i = 0; i < queries; i++) {
+    cin >> type >> word;
+
+    if (type == 1) {
+      trie.add(word);
+      stale = true;
+    } else {
+      if (stale) {
+        frozen = trie.freeze();
+        stale = false;
+      }
+      cout << frozen.exists(word) << endl;
+    }
+  }
+}
+
+
+/**
+ *  Answers the queries from stdin (see main): words are added to a
+ *  TrieNode, which is written to the LOUDS file at path and mapped again
+ *  before the first lookup after any add.
+ */
+static void answer_louds_queries(const char* path) {
+  int queries;
+  cin >> queries;
+
+  TrieNode trie;
+  LoudsTrie louds;
+  bool stale = true;
+
+  int type;
+  string word;
+  for (int i = 0; i < queries; i++) {
+    cin >> type >> word;
+
+    if (type == 1) {
+      trie.add(word);
+      stale = true;
+    } else {
+      if (stale) {
+        louds.close();
+        if (!LoudsTrie::write(path, trie) or !louds.open(path)) {
+          cerr << "cannot write the LOUDS file" << endl;
+          return;
+        }
+        stale = false;
+      }
+      cout << louds.exists(word) << endl;
+    }
+  }
+}
+
+
+/**
+ *  Answers the pending lookups with coroutines and clears them.
+ */
+static void flush_lookups(TrieNode* root, vector<string>& pending, int width) {
+  vector<bool> found;
+  root->exists_interleaved(pending, width, found);
+
+  for (int i = 0; i < (int)found.size(); i++) {
+    cout << found[i] << endl;
+  }
+  pending.clear();
+}
+
+
+/**
+ *  Driver program to test functionality.
+ *  Usage:
+ *    trie                - reads the queries from stdin
+ *    trie coro [width]   - same, consecutive lookups run as width >= 1 interleaved
+ *                          coroutines (default 16)
+ *    trie radix          - same, with the path-compressed RadixTrie
+ *    trie louds file     - same, lookups answered from a LOUDS file written at file
+ *                          from the words added so far (rewritten after new adds)
+ *    trie louds-open file
+ *                        - reads q, then q words, and prints for each whether it
+ *                          is in the existing LOUDS file, without rebuilding it
+ *    trie art            - same, with the adaptive radix tree (words may hold any byte)
+ *    trie frozen         - same, lookups answered by a double-array trie frozen
+ *                          from the words added so far (refrozen after new adds)
+ *    trie bench [n]      - runs the benchmark on n words (default 100000)
+ *    trie bench-engines [n]
+ *                        - compares the engines on n identifiers (default 1000000)
+ */
+int main(int argc, char** argv) {
+  ios::sync_with_stdio(false);
+
+  string mode = (argc > 1) ? argv[1] : "";
+  if (mode == "bench") {
+    run_benchmark((argc > 2) ? atoi(argv[2]) : 100000);
+    return 0;
+  }
+  if (mode == "bench-engines") {
+    run_engine_benchmark((argc > 2) ? atoi(argv[2]) : 1000000);
+    return 0;
+  }
+  if (mode == "radix") {
+    RadixTrie trie;
+    answer_queries(trie);
+    return 0;
+  }
+  if (mode == "frozen") {
+    answer_frozen_queries();
+    return 0;
+  }
+  if (mode == "louds") {
+    answer_louds_queries((argc > 2) ? argv[2] : "trie.louds");
+    return 0;
+  }
+  if (mode == "louds-open") {
+    LoudsTrie trie;
+    if (argc < 3 or !trie.open(argv[2])) {
+      cerr << "cannot open the LOUDS file" << endl;
+      return 1;
+    }
+
+    int queries;
+    string word;
+    cin >> queries;
+    for (int i = 0; i < queries; i++) {
+      cin >> word;
+      cout << trie.exists(word) << endl;
+    }
+    return 0;
+  }
+  if (mode == "art") {
+    ArtTrie trie;
+    answer_queries(trie);
+    return 0;
+  }
+
+  bool interleave = (mode == "coro");
+  int width = (argc > 2) ? atoi(argv[2]) : 16;
+  if (interleave and width < 1) {
+    cerr << "the coroutine width must be at least 1" << endl;
+    return 1;
+  }
+  vector<string> pending; // Lookups not answered yet (coro mode)
+
+  int queries;
+  cin >> queries;
+
+  int type;
+  string word;
+  TrieNode* root = new TrieNode();  // Empty node (no key)
+
+  for (int i = 0; i < queries; i++) {
+    cin >> type >> word;
+
+    if (type == 1) {
+      if (!pending.empty()) {
+        flush_lookups(root, pending, width);
+      }
+      root->add(word);
+    } else if (interleave) {
+      pending.push_back(word);
+    } else {
+      cout << root->exists(word) << endl;
+    }
+  }
+
+  if (!pending.empty()) {
+    flush_lookups(root, pending, width);
   }
 
   delete root;  // Free memory